@@ -0,0 +1,76 @@
+#include <kovan/kovan.hpp>
+#include <opencv2/core/core.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+// Creates the input provider for the first argument: a recording, or
+// v4l2:<n>[:mjpeg] for /dev/video<n>, e.g. a vivid or v4l2loopback device
+static Camera::InputProvider *inputProvider(const char *const source, int &number)
+{
+	number = 0;
+#ifdef __linux__
+	if(!strncmp(source, "v4l2:", 5)) {
+		char *end = 0;
+		number = strtol(source + 5, &end, 10);
+		const bool mjpeg = end && !strcmp(end, ":mjpeg");
+		return new Camera::V4L2InputProvider(mjpeg
+			? Camera::V4L2InputProvider::Mjpeg : Camera::V4L2InputProvider::Yuyv);
+	}
+#endif
+	return new Camera::RecordedInputProvider(source);
+}
+
+// Runs a recording or a live V4L2 device through a Camera::Device with the
+// given channel config and reports how long each stage of the vision
+// pipeline took.
+int main(int argc, char *argv[])
+{
+	if(argc < 3) {
+		std::cerr << "usage: " << argv[0] << " <recording | v4l2:<n>[:mjpeg]> <channel config> [frames]"
+			<< std::endl;
+		return 1;
+	}
+	
+	const unsigned maxFrames = argc > 3 ? strtoul(argv[3], 0, 10) : 0;
+	
+	Config *config = Config::load(argv[2]);
+	if(!config) {
+		std::cerr << "Failed to load " << argv[2] << std::endl;
+		return 1;
+	}
+	
+	int number = 0;
+	Camera::Device device(inputProvider(argv[1], number));
+	if(!device.open(number)) {
+		std::cerr << "Failed to open " << argv[1] << std::endl;
+		delete config;
+		return 1;
+	}
+	device.setConfig(*config);
+	delete config;
+	
+	Camera::Profiler *const profiler = Camera::Profiler::instance();
+	profiler->reset();
+	profiler->setEnabled(true);
+	
+	unsigned frames = 0;
+	unsigned long objects = 0;
+	const long long start = cv::getTickCount();
+	while((!maxFrames || frames < maxFrames) && device.update()) {
+		const Camera::ChannelPtrVector &channels = device.channels();
+		Camera::ChannelPtrVector::const_iterator it = channels.begin();
+		for(; it != channels.end(); ++it) {
+			const Camera::ObjectVector *const o = (*it)->objects();
+			if(o) objects += o->size();
+		}
+		++frames;
+	}
+	const double elapsed = (cv::getTickCount() - start) / cv::getTickFrequency();
+	
+	std::cout << frames << " frames, " << objects << " objects in "
+		<< elapsed << " s (" << (elapsed > 0.0 ? frames / elapsed : 0.0) << " fps)" << std::endl;
+	profiler->report(std::cout);
+	
+	return 0;
+}
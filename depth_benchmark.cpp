@@ -0,0 +1,81 @@
+#include <kovan/kovan.hpp>
+#include <kovan/depth.h>
+#include <opencv2/core/core.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+// Replays a depth recording through the depth C API and reports how long
+// scanline segmentation, point cloud generation and full frame
+// segmentation took per frame.
+static void report(const char *const stage, const double total, const unsigned frames)
+{
+	std::cout << std::left << std::setw(16) << stage
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(14) << total * 1000.0
+		<< std::setw(14) << (frames ? total * 1000.0 / frames : 0.0) << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2) {
+		std::cerr << "usage: " << argv[0] << " <depth recording> [frames]" << std::endl;
+		return 1;
+	}
+	
+	const unsigned maxFrames = argc > 2 ? strtoul(argv[2], 0, 10) : 0;
+	
+	depth::RecordedDepthDriver driver(argv[1]);
+	depth::DepthDriver::setInstance(&driver);
+	try {
+		driver.open();
+	} catch(const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	
+	const double frequency = cv::getTickFrequency();
+	double scanlines = 0.0;
+	double points = 0.0;
+	double segmentation = 0.0;
+	unsigned frames = 0;
+	unsigned long objects = 0;
+	std::vector<int> rows;
+	std::vector<point3> cloud;
+	while((!maxFrames || frames < maxFrames) && depth_update()) {
+		const int height = get_depth_image_height();
+		const int width = get_depth_image_width();
+		
+		// Every eighth row, like a robot scanning for objects
+		rows.clear();
+		for(int row = 0; row < height; row += 8) rows.push_back(row);
+		long long start = cv::getTickCount();
+		depth_scanlines_update(&rows[0], rows.size());
+		scanlines += (cv::getTickCount() - start) / frequency;
+		
+		cloud.resize(width * height);
+		start = cv::getTickCount();
+		get_depth_world_points(0, height, &cloud[0]);
+		points += (cv::getTickCount() - start) / frequency;
+		
+		start = cv::getTickCount();
+		depth_segment_update();
+		segmentation += (cv::getTickCount() - start) / frequency;
+		objects += get_depth_object_count();
+		
+		++frames;
+	}
+	
+	depth::DepthDriver::setInstance(0);
+	
+	std::cout << frames << " frames, " << objects << " objects" << std::endl;
+	std::cout << std::left << std::setw(16) << "stage"
+		<< std::right << std::setw(14) << "total (ms)"
+		<< std::setw(14) << "avg (ms)" << std::endl;
+	report("scanlines", scanlines, frames);
+	report("points", points, frames);
+	report("segmentation", segmentation, frames);
+	
+	return 0;
+}
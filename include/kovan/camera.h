@@ -45,6 +45,20 @@ typedef struct pixel
 	int b;
 } pixel;
 
+/**
+ * Everything known about one object on a channel
+ * \see get_channel_objects
+ * \ingroup camera
+ */
+typedef struct camera_object
+{
+	point2 centroid;
+	point2 center;
+	rectangle bbox;
+	int area;
+	double confidence;
+} camera_object;
+
 enum Resolution
 {
 	LOW_RES,
@@ -69,6 +83,7 @@ EXPORT_SYM int camera_open();
  *   - LOW_RES (160x120)
  *   - MED_RES (320x240)
  *   - HIGH_RES (640x480)
+ *   - NATIVE_RES (leaves the camera at its current resolution)
  * \return 1 on success, 0 on failure
  * \see camera_open
  * \see camera_open_device
@@ -84,6 +99,7 @@ EXPORT_SYM int camera_open_at_res(enum Resolution res);
  *   - LOW_RES (160x120)
  *   - MED_RES (320x240)
  *   - HIGH_RES (640x480)
+ *   - NATIVE_RES (leaves the camera at its current resolution)
  * \return 1 on success, 0 on failure
  * \see camera_open
  * \see camera_close
@@ -91,6 +107,18 @@ EXPORT_SYM int camera_open_at_res(enum Resolution res);
  */
 EXPORT_SYM int camera_open_device(int number, enum Resolution res);
 
+/**
+ * Opens the Xtion's color camera, with its depth stream registered to it.
+ * Channels work on the color image as usual, and objects can additionally
+ * be located in 3D.
+ * \param res The resolution the camera should operate at, see camera_open_at_res
+ * \return 1 on success, 0 on failure
+ * \see get_object_world_centroid
+ * \see camera_close
+ * \ingroup camera
+ */
+EXPORT_SYM int camera_open_rgbd(enum Resolution res);
+
 /**
  * Loads the config file specified by name.
  * \param name The configuration to load. Configuration file names are case sensitive.
@@ -233,6 +261,73 @@ EXPORT_SYM int get_object_center_x(int channel, int object);
 EXPORT_SYM int get_object_center_row(int channel, int object);
 EXPORT_SYM int get_object_center_y(int channel, int object);
 
+/**
+ * \return The world coordinates, in mm, of the given object on the given
+ * channel, from the median depth around its centroid. (-1, -1, -1) is
+ * returned if the channel or object doesn't exist, or the camera wasn't
+ * opened with camera_open_rgbd.
+ * \see camera_open_rgbd
+ * \ingroup camera
+ */
+EXPORT_SYM point3 get_object_world_centroid(int channel, int object);
+
+/**
+ * Copies the objects of a channel into a caller provided array. This is
+ * cheaper than reading the fields of every object through the individual
+ * getters.
+ * \param channel The channel to copy objects from.
+ * \param objects The array to copy the objects into.
+ * \param max_objects The number of elements objects can hold.
+ * \note Objects are sorted by area, largest first.
+ * \return The number of objects copied, -1 if the channel doesn't exist.
+ * \see get_object_count
+ * \ingroup camera
+ */
+EXPORT_SYM int get_channel_objects(int channel, camera_object *objects, int max_objects);
+
+/**
+ * Starts or stops tracking the objects of a channel across frames. Tracked
+ * objects keep their id for as long as they stay in view, and their
+ * centers are smoothed, unlike object indices which follow the sort
+ * order of every frame. Tracking is stopped when a new configuration is
+ * loaded or the camera is closed.
+ * \param channel The channel to track objects on.
+ * \param enabled 1 to start tracking, 0 to stop.
+ * \return 1 on success, 0 if the channel doesn't exist.
+ * \see get_tracked_object_id
+ * \ingroup camera
+ */
+EXPORT_SYM int set_object_tracking(int channel, int enabled);
+
+/**
+ * \return The number of objects tracked on the given channel, -1 if
+ * tracking isn't enabled on it.
+ * \ingroup camera
+ */
+EXPORT_SYM int get_tracked_object_count(int channel);
+
+/**
+ * \param index The index of the tracked object, between 0 and
+ * get_tracked_object_count() - 1. Tracked objects are ordered oldest first.
+ * \return The stable id of the tracked object, -1 if it doesn't exist.
+ * \ingroup camera
+ */
+EXPORT_SYM int get_tracked_object_id(int channel, int index);
+
+/**
+ * \return The smoothed (x, y) center of the tracked object with the given
+ * id, or (-1, -1) if it isn't tracked anymore.
+ * \ingroup camera
+ */
+EXPORT_SYM point2 get_tracked_object_center(int channel, int id);
+
+/**
+ * \return The last observed bounding box of the tracked object with the
+ * given id, or (-1, -1, 0, 0) if it isn't tracked anymore.
+ * \ingroup camera
+ */
+EXPORT_SYM rectangle get_tracked_object_bbox(int channel, int id);
+
 /**
  * Cleanup the current camera instance.
  * \see camera_open
@@ -261,11 +356,24 @@ EXPORT_SYM const unsigned char *get_camera_frame_row(unsigned row);
  * Retrieves the current camera frame as a BGR (BGR888) array. The returned
  * pointer is invalid after camera_update() is called again.
  * 
+ * \note No copy is made if the frame is already packed in memory.
  * \return the current BGR888 camera frame.
  * \ingroup camera
  */
 EXPORT_SYM const unsigned char *get_camera_frame();
 
+/**
+ * The distance in bytes between the starts of two consecutive rows of the
+ * current camera frame. Row n of the frame starts at
+ * get_camera_frame_row(0) + n * get_camera_frame_stride(), which allows
+ * reading the frame without any copies.
+ * 
+ * \return the row stride of the current camera frame in bytes.
+ * \see get_camera_frame_row
+ * \ingroup camera
+ */
+EXPORT_SYM unsigned get_camera_frame_stride();
+
 EXPORT_SYM unsigned get_camera_element_size();
 
 #ifdef __cplusplus
@@ -32,13 +32,16 @@
 #include "geom.hpp"
 #include "color.hpp"
 #include "config.hpp"
+#include "thread.hpp"
 #include "export.h"
 #include <cstring>
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <iostream>
 #include "depth_driver.hpp"
+#include "ground_plane.hpp"
 #include <QColor>
 
 #ifndef WIN32
@@ -61,14 +64,35 @@
 #define CAMERA_CHANNEL_TYPE_HSV_KEY ("hsv")
 #define CAMERA_CHANNEL_TYPE_QR_KEY ("qr")
 
+// Optional per-channel keys restricting the processed window.
+// A channel without a roi_width/roi_height scans the whole frame.
+// decimation (2 or 4) processes the window at half or quarter resolution.
+#define CAMERA_CHANNEL_ROI_X_KEY ("roi_x")
+#define CAMERA_CHANNEL_ROI_Y_KEY ("roi_y")
+#define CAMERA_CHANNEL_ROI_WIDTH_KEY ("roi_width")
+#define CAMERA_CHANNEL_ROI_HEIGHT_KEY ("roi_height")
+#define CAMERA_CHANNEL_ROI_FOLLOW_KEY ("roi_follow")
+#define CAMERA_CHANNEL_DECIMATION_KEY ("decimation")
+
+// hsv channels with this key set classify pixels through a color lookup
+// table instead of thresholding an HSV image
+#define CAMERA_CHANNEL_LUT_KEY ("lut")
+
 namespace cv
 {
 	class VideoCapture;
 }
 
+namespace Private
+{
+	class ChannelWorker;
+	class ChannelWorkerPool;
+}
+
 namespace Camera
 {
 	class Device;
+	class FrameRecorder;
 	
 	class EXPORT_SYM Object
 	{
@@ -78,8 +102,17 @@ namespace Camera
 			const double &confidence, const char *data = 0,
 			const size_t &dataLength = 0);
 		Object(const Object &rhs);
+#if __cplusplus >= 201103L
+		Object(Object &&rhs);
+#endif
 		~Object();
 		
+		Object &operator =(const Object &rhs);
+#if __cplusplus >= 201103L
+		Object &operator =(Object &&rhs);
+#endif
+		void swap(Object &rhs);
+		
 		const Point2<unsigned> &centroid() const;
 		const Rect<unsigned> &boundingBox() const;
 		const double confidence() const;
@@ -87,15 +120,149 @@ namespace Camera
 		const size_t dataLength() const;
 		
 	private:
+		// Payloads that fit (including the null terminator) are stored
+		// inline, so copying an Object with barcode data doesn't allocate.
+		enum { InlineDataSize = 64 };
+		
+		void setData(const char *data, const size_t &dataLength);
+		void releaseData();
+		bool isInline() const;
+		
 		Point2<unsigned> m_centroid;
 		Rect<unsigned> m_boundingBox;
 		double m_confidence;
 		char *m_data;
 		size_t m_dataLength;
+		char m_inlineData[InlineDataSize];
 	};
 	
 	typedef std::vector<Object> ObjectVector;
 	
+	/**
+	 * A lookup table indexed by quantized BGR values holding, for every
+	 * color, a bitmask of the HSV ranges it falls within. Classifying a
+	 * frame once yields a label image that every range can be masked from.
+	 */
+	class EXPORT_SYM ColorTable
+	{
+	public:
+		enum
+		{
+			Bits = 5,
+			Size = 1 << (3 * Bits),
+			MaxRanges = 32
+		};
+		
+		ColorTable();
+		
+		void clear();
+		
+		/**
+		 * Adds the range of an hsv channel (bh > th wraps around the hue
+		 * circle). Identical ranges share a bit.
+		 * \return the range's bit, or -1 if the table is full
+		 */
+		int add(const cv::Vec3b &bottom, const cv::Vec3b &top);
+		
+		/**
+		 * \return the bit of the given range, or -1 if it isn't in the table
+		 */
+		int bit(const cv::Vec3b &bottom, const cv::Vec3b &top) const;
+		
+		bool isEmpty() const;
+		
+		/**
+		 * Writes the bitmask of every pixel of bgr to labels (CV_32SC1)
+		 */
+		void classify(const cv::Mat &bgr, cv::Mat &labels) const;
+		
+		/**
+		 * Writes 255 for every pixel of bgr within the range of the given
+		 * bit and 0 otherwise to mask (CV_8UC1)
+		 */
+		void classify(const cv::Mat &bgr, const int bit, cv::Mat &mask) const;
+		
+	private:
+		static unsigned long long key(const cv::Vec3b &bottom, const cv::Vec3b &top);
+		
+		std::vector<unsigned long long> m_ranges;
+		std::vector<unsigned int> m_table;
+	};
+	
+	/**
+	 * Derived images of the current frame, shared by all ChannelImpls of a
+	 * Device. Every conversion is computed lazily, at most once per frame,
+	 * into buffers that are reused from frame to frame. Safe to use from
+	 * multiple threads.
+	 */
+	class EXPORT_SYM FrameCache
+	{
+	public:
+		FrameCache();
+		~FrameCache();
+		
+		/**
+		 * Replaces the current frame and invalidates all derived images.
+		 * frameNumber is the device's frame number of the image.
+		 */
+		void setImage(const cv::Mat &image, const unsigned long frameNumber);
+		const cv::Mat &image() const;
+		unsigned long frameNumber() const;
+		
+		/**
+		 * \return true if image is the current frame itself (rather than a
+		 * window or a copy of it)
+		 */
+		bool isFrame(const cv::Mat &image) const;
+		
+		/**
+		 * The current frame converted by cv::cvtColor with the given code,
+		 * e.g. CV_BGR2HSV or CV_BGR2GRAY.
+		 */
+		const cv::Mat &converted(const int code);
+		
+		/**
+		 * The current frame box filtered down to 1 / 2^level of its size.
+		 * Level 0 is the frame itself.
+		 */
+		const cv::Mat &level(const unsigned level);
+		
+		/**
+		 * The table labels() classifies the frame with. Not owned.
+		 */
+		void setColorTable(const ColorTable *const colorTable);
+		const ColorTable *colorTable() const;
+		
+		/**
+		 * The current frame classified by the color table
+		 * \see ColorTable::classify
+		 */
+		const cv::Mat &labels();
+		
+	private:
+		FrameCache(const FrameCache &rhs);
+		FrameCache &operator =(const FrameCache &rhs);
+		
+		struct Entry
+		{
+			Entry();
+			
+			bool valid;
+			cv::Mat image;
+			Mutex mutex;
+		};
+		
+		Entry *entry(std::map<int, Entry *> &entries, const int key);
+		
+		cv::Mat m_image;
+		unsigned long m_frameNumber;
+		std::map<int, Entry *> m_conversions;
+		std::map<int, Entry *> m_levels;
+		const ColorTable *m_colorTable;
+		Entry m_labels;
+		Mutex m_mutex;
+	};
+	
 	class EXPORT_SYM ChannelImpl
 	{
 	public:
@@ -105,13 +272,64 @@ namespace Camera
 		void setImage(const cv::Mat &image);
 		ObjectVector objects(const Config &config);
 		
+		/**
+		 * Lets the impl share conversions of the frame with other impls.
+		 * Set by the Device's ChannelImplManager.
+		 */
+		void setFrameCache(FrameCache *const frameCache);
+		
+		/**
+		 * Finds objects like objects(const Config &), but writes them into
+		 * the given vector. The vector is cleared first; its capacity is
+		 * reused, so repeated calls with the same vector don't allocate.
+		 */
+		void objects(const Config &config, ObjectVector &objects);
+		
+		/**
+		 * Finds objects inside of the window roi of the current image,
+		 * optionally subsampled by decimation (2 or 4). Only the window is
+		 * passed to update(). The returned objects are in full frame
+		 * coordinates. An empty roi selects the whole image.
+		 *
+		 * If the current image is the device's frame, the decimated window
+		 * is cut out of the frame cache's box filtered pyramid, which is
+		 * shared by all channels running at the same level.
+		 */
+		void objects(const Config &config, ObjectVector &objects,
+			const cv::Rect &roi, const unsigned decimation = 1);
+		
 	protected:
 		virtual void update(const cv::Mat &image) = 0;
-		virtual ObjectVector findObjects(const Config &config) = 0;
+		
+		/**
+		 * The frame cache of the device, or 0 if there is none. Only use it
+		 * from update() when frameCache()->isFrame(image) is true.
+		 */
+		FrameCache *frameCache() const;
+		
+		/**
+		 * Implementations must override at least one of the findObjects
+		 * methods. The default implementations are defined in terms of
+		 * each other; debug builds abort if neither is overridden.
+		 */
+		virtual ObjectVector findObjects(const Config &config);
+		
+		/**
+		 * Writes the objects of the current image into the given vector,
+		 * which is empty but may have capacity left from earlier calls.
+		 * Overriding this one avoids a copy per frame.
+		 */
+		virtual void findObjects(const Config &config, ObjectVector &objects);
 		
 	private:
 		bool m_dirty;
+		bool m_findingObjects;
 		cv::Mat m_image;
+		FrameCache *m_frameCache;
+		
+		cv::Rect m_window;
+		unsigned m_decimation;
+		cv::Mat m_decimated;
 	};
 	
 	class EXPORT_SYM ChannelImplManager
@@ -120,6 +338,12 @@ namespace Camera
 		virtual ~ChannelImplManager();
 		virtual void setImage(const cv::Mat &image) = 0;
 		virtual ChannelImpl *channelImpl(const std::string &name) = 0;
+		
+		/**
+		 * Called by the Device with its frame cache. The default
+		 * implementation does nothing.
+		 */
+		virtual void setFrameCache(FrameCache *const frameCache);
 	};
 	
 	class EXPORT_SYM DefaultChannelImplManager : public ChannelImplManager
@@ -130,6 +354,7 @@ namespace Camera
 		
 		virtual void setImage(const cv::Mat &image);
 		virtual ChannelImpl *channelImpl(const std::string &name);
+		virtual void setFrameCache(FrameCache *const frameCache);
 		
 	private:
 		std::map<std::string, ChannelImpl *> m_channelImpls;
@@ -146,18 +371,55 @@ namespace Camera
 		const ObjectVector *objects() const;
 		
 		Device *device() const;
+		ChannelImpl *channelImpl() const;
 		
 		/**
 		 * Do not call this method unless you know what you are doing!
 		 */ 
 		void setConfig(const Config &config);
 		
+		/**
+		 * The window this channel is restricted to. An empty rectangle
+		 * means the whole frame.
+		 */
+		const cv::Rect &regionOfInterest() const;
+		unsigned decimation() const;
+		
+		/**
+		 * Restricts the next evaluation of this channel to window, e.g. a
+		 * window predicted by an ObjectTracker. If nothing is found inside
+		 * of it, the whole region of interest is searched instead. The hint
+		 * only applies to a single frame.
+		 */
+		void setSearchWindow(const cv::Rect &window);
+		
+		/**
+		 * \return false if objects() wasn't called within the device's
+		 * demand window
+		 * \see Device::setDemandWindow
+		 */
+		bool isInDemand() const;
+		
 	private:
+		friend class Device;
+		friend class Private::ChannelWorker;
+		
+		void readConfig();
+		const ObjectVector *evaluate() const;
+		
 		Device *m_device;
 		Config m_config;
 		mutable ObjectVector m_objects;
 		ChannelImpl *m_impl;
 		mutable bool m_valid;
+		
+		cv::Rect m_roi;
+		unsigned m_decimation;
+		bool m_follow;
+		mutable cv::Rect m_searchWindow;
+		
+		mutable unsigned long m_lastQueried;
+		bool m_starved;
 	};
 	
 	typedef std::vector<Channel *> ChannelPtrVector;
@@ -187,6 +449,12 @@ namespace Camera
 		virtual void setHeight(const unsigned height) = 0;
 		virtual bool next(cv::Mat &image) = 0;
 		virtual bool close() = 0;
+		
+		/**
+		 * Locates a window of the last image in the world, in mm. Only
+		 * providers with depth information can, the default returns false.
+		 */
+		virtual bool worldPoint(const Rect<unsigned> &window, Point3<int32_t> &point) const;
 	};
 	
 	class EXPORT_SYM UsbInputProvider : public InputProvider
@@ -217,6 +485,28 @@ namespace Camera
 		virtual void setHeight(const unsigned height);
 		virtual bool next(cv::Mat &image);
 		virtual bool close();
+		
+		/**
+		 * While enabled, the ground plane is fitted to every depth frame
+		 * and ground pixels are colored black like pixels without a depth
+		 * value, so channels only see objects. Disabled by default.
+		 */
+		void setGroundRemoval(const bool groundRemoval);
+		bool groundRemoval() const;
+		
+		depth::GroundPlane *groundPlane();
+		
+	private:
+		unsigned m_width;
+		unsigned m_height;
+		bool m_groundRemoval;
+		depth::GroundPlane m_groundPlane;
+		
+		// Scratch space reused between frames
+		std::vector<uint32_t> m_columns;
+		std::vector<uint16_t> m_row;
+		std::vector<uint8_t> m_ground;
+		uint32_t m_depthWidth;
 	};
 
 	
@@ -241,6 +531,7 @@ namespace Camera
 		
 		InputProvider *inputProvider() const;
 		const cv::Mat &rawImage() const;
+		FrameCache *frameCache();
 		
 		void setConfig(const Config &config);
 		const Config &config() const;
@@ -248,20 +539,92 @@ namespace Camera
 		void setChannelImplManager(ChannelImplManager *channelImplManager);
 		ChannelImplManager *channelImplManager() const;
 		
+		/**
+		 * The current frame as a packed BGR888 array. If the frame is
+		 * continuous in memory, this points directly into it and no copy is
+		 * made. Invalid after the next update().
+		 */
 		const unsigned char *bgr() const;
 		
+		/**
+		 * The current frame as a BGR888 array without ever copying it.
+		 * Row n starts at n * stride bytes from the returned pointer.
+		 * Invalid after the next update().
+		 */
+		const unsigned char *bgr(unsigned &stride) const;
+		
+		/**
+		 * When enabled, update() evaluates every channel before it returns,
+		 * with channels that use different ChannelImpls running in parallel
+		 * on their own threads. The threads are started as needed and kept
+		 * until the device is destroyed. Channel::objects() then returns
+		 * immediately.
+		 * Disabled by default, in which case channels are evaluated lazily
+		 * on the calling thread.
+		 */
+		void setParallelChannels(const bool parallel);
+		bool parallelChannels() const;
+		
+		/**
+		 * Channels whose objects weren't requested during the last frames
+		 * updates are considered idle. The ChannelImpls used only by idle
+		 * channels don't get new frames (and don't keep a reference to the
+		 * old one) until one of their channels is queried again. Idle
+		 * channels are also skipped by parallel evaluation. 0, the default,
+		 * disables demand tracking and feeds every impl through the
+		 * ChannelImplManager.
+		 */
+		void setDemandWindow(const unsigned frames);
+		unsigned demandWindow() const;
+		
+		/**
+		 * The number of frames successfully captured by update()
+		 */
+		unsigned long frameNumber() const;
+		
+		/**
+		 * Every frame captured by update() is also written to the given
+		 * recorder. The recorder isn't owned by the device; pass 0 to stop
+		 * recording.
+		 */
+		void setRecorder(FrameRecorder *const recorder);
+		FrameRecorder *recorder() const;
+		
+		/**
+		 * Locates an object of the current frame in the world through the
+		 * input provider. The center half of the bounding box is used, so
+		 * the object's edges don't pick up the background's depth.
+		 * \return false if the input provider has no depth information
+		 * \see InputProvider::worldPoint
+		 */
+		bool worldCentroid(const Object &object, Point3<int32_t> &point) const;
+		
 	private:
+		friend class Channel;
+		
 		void updateConfig();
+		void feed(ChannelImpl *const impl);
 		
 		InputProvider *const m_inputProvider;
 		Config m_config;
 		ChannelPtrVector m_channels;
 		ChannelImplManager *m_channelImplManager;
 		cv::Mat m_image;
+		FrameCache m_frameCache;
 		timeval m_lastUpdate;
 		
 		mutable unsigned char *m_bgr;
 		mutable unsigned m_bgrSize;
+		
+		bool m_parallel;
+		Private::ChannelWorkerPool *m_workers;
+		
+		ColorTable m_colorTable;
+		
+		unsigned m_demandWindow;
+		unsigned long m_frameNumber;
+		
+		FrameRecorder *m_recorder;
 	};
 	
 	/**
@@ -270,6 +633,15 @@ namespace Camera
 	Camera::Device *cDevice();
 }
 
+namespace std
+{
+	template<>
+	inline void swap(Camera::Object &lhs, Camera::Object &rhs)
+	{
+		lhs.swap(rhs);
+	}
+}
+
 
 
 #endif
@@ -0,0 +1,98 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+#ifndef _CAMERA_PROFILER_HPP_
+#define _CAMERA_PROFILER_HPP_
+
+#include "thread.hpp"
+#include "export.h"
+
+#include <ostream>
+
+namespace Camera
+{
+	/**
+	 * Accumulates the time spent in each stage of the vision pipeline.
+	 * Disabled by default, in which case timing a stage costs a single
+	 * branch.
+	 */
+	class EXPORT_SYM Profiler
+	{
+	public:
+		enum Stage
+		{
+			Capture = 0,
+			Conversion,
+			Threshold,
+			BlobExtraction,
+			Sort,
+			StageCount
+		};
+		
+		/**
+		 * Times the enclosing scope as the given stage.
+		 */
+		class EXPORT_SYM Scope
+		{
+		public:
+			Scope(const Stage stage);
+			~Scope();
+			
+		private:
+			Stage m_stage;
+			long long m_start;
+		};
+		
+		static Profiler *instance();
+		
+		void setEnabled(const bool enabled);
+		bool isEnabled() const;
+		
+		void reset();
+		
+		/**
+		 * Thread safe, so parallel channels can report concurrently.
+		 */
+		void add(const Stage stage, const double seconds);
+		
+		unsigned count(const Stage stage) const;
+		double total(const Stage stage) const;
+		double average(const Stage stage) const;
+		
+		/**
+		 * Writes one line per stage: calls, total and average in milliseconds
+		 */
+		void report(std::ostream &out) const;
+		
+		static const char *stageName(const Stage stage);
+		
+	private:
+		Profiler();
+		Profiler(const Profiler &rhs);
+		Profiler &operator =(const Profiler &rhs);
+		
+		bool m_enabled;
+		unsigned m_counts[StageCount];
+		double m_totals[StageCount];
+		mutable Mutex m_mutex;
+	};
+}
+
+#endif
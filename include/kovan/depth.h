@@ -112,6 +112,32 @@ EXPORT_SYM int get_depth_orientation();
  */
 EXPORT_SYM int depth_update();
 
+/**
+ * Returns the sequence number of the depth image stored by depth_update.
+ * Consecutive images differ by more than 1 if frames were dropped.
+ *
+ * \return Sequence number starting at 1, or 0 if no depth image was saved
+ *
+ * \see depth_update
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_frame_number();
+
+/**
+ * Returns the time the depth image stored by depth_update was captured at,
+ * as stamped by the sensor
+ *
+ * \return Seconds on the sensor's clock, or 0.0 if no depth image was
+ *         saved. Only differences between timestamps are meaningful; they
+ *         are not comparable to seconds().
+ *
+ * \see depth_update
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM double get_depth_frame_timestamp();
+
 /**
  * Returns the height of the depth image stored by depth_update in pixel
  *
@@ -212,6 +238,23 @@ EXPORT_SYM int get_depth_world_point_y(int row, int column);
  */
 EXPORT_SYM int get_depth_world_point_z(int row, int column);
 
+/**
+ * Converts whole rows of the depth image stored by depth_update to world
+ * coordinates. Much faster than calling get_depth_world_point for every
+ * pixel.
+ *
+ * \param row Index of the first row to convert
+ * \param rows Number of rows to convert
+ * \param points Receives get_depth_image_width() * rows points, row by
+ *        row. Pixels without a depth value are set to (0, 0, 0).
+ * \return 1 on success, 0 otherwise
+ *
+ * \note the row/column index starts with 0
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_world_points(int row, int rows, point3 *points);
+
 #ifdef __linux__
 static const int INVALID_DEPTH = 2147483647;
 #else
@@ -231,6 +274,32 @@ static const int INVALID_DEPTH = INT32_MAX;
  */
 EXPORT_SYM int depth_scanline_update(int row);
 
+/**
+ * Segments several rows in one call. Nearest, farthest and center points
+ * of every object are computed up front, so the get_depth_scanline
+ * functions don't touch the depth image again. The first row is selected.
+ *
+ * \param rows The row indices to segment
+ * \param count The number of rows
+ * \return 1 on success, 0 otherwise
+ *
+ * \note Calling depth_update() invalidates all rows.
+ * \see depth_scanline_select
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int depth_scanlines_update(const int *rows, int count);
+
+/**
+ * Selects one of the rows segmented by the last depth_scanlines_update()
+ * call for the get_depth_scanline functions.
+ *
+ * \return 1 on success, 0 if the row wasn't segmented
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int depth_scanline_select(int row);
+
 /**
  * Retrieve the number of objects detected on the selected scanline.
  *
@@ -353,6 +422,152 @@ typedef enum SortMethod_
 EXPORT_SYM void set_depth_scanline_sorting_method(SortMethod method);
 EXPORT_SYM SortMethod get_depth_scanline_sorting_method();
 
+/**
+ * Enables or disables the depth filter. While enabled, short holes in
+ * the depth image are filled and every pixel is smoothed over time,
+ * which makes scanline and object detection more stable.
+ *
+ * \param enabled 1 to enable the filter, 0 to disable it
+ * \return 1 on success, 0 otherwise (e.g. the depth driver doesn't
+ *         support filtering)
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int set_depth_filter(int enabled);
+
+/**
+ * \return 1 if the depth filter is enabled, 0 otherwise
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_filter();
+
+/**
+ * Enables or disables ground removal. While enabled, depth_update fits
+ * the ground plane to every new image, and depth_scanline_update and
+ * depth_segment_update ignore pixels on the ground.
+ *
+ * \param enabled 1 to enable ground removal, 0 to disable it
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM void set_depth_ground_removal(int enabled);
+
+/**
+ * \return 1 if ground removal is enabled, 0 otherwise
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_ground_removal();
+
+/**
+ * \return The height of the depth sensor above the ground in mm, or -1 if
+ *         ground removal is disabled or no ground was found
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_camera_height();
+
+/**
+ * Splits the whole depth image stored by depth_update into objects:
+ * connected regions without depth discontinuities. Objects are sorted
+ * nearest first.
+ *
+ * \return 1 on success, 0 otherwise
+ *
+ * \note Calling depth_update() invalidates the objects.
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int depth_segment_update();
+
+/**
+ * \return The number of objects found by depth_segment_update, or -1 on
+ *         error
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_object_count();
+
+/**
+ * \return The number of depth pixels the given object covers, or -1 on
+ *         error
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_object_pixel_count(int object_num);
+
+/**
+ * \return The mean world coordinates of the given object in mm, or
+ *         (-1, -1, -1) on error
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM point3 get_depth_object_centroid(int object_num);
+
+/**
+ * \return The world coordinates of the given object's point nearest to
+ *         the camera in mm, or (-1, -1, -1) on error
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM point3 get_depth_object_nearest(int object_num);
+
+/**
+ * \return The minimum world coordinates of the given object's bounding
+ *         box in mm, or (-1, -1, -1) on error
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM point3 get_depth_object_bbox_min(int object_num);
+
+/**
+ * \return The maximum world coordinates of the given object's bounding
+ *         box in mm, or (-1, -1, -1) on error
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM point3 get_depth_object_bbox_max(int object_num);
+
+/**
+ * Projects the depth image stored by depth_update into a top down
+ * obstacle grid in front of the sensor. Cells need to be hit in several
+ * consecutive updates to become obstacles, so call this once per frame.
+ * Obstacles are points 50 to 1000 mm above the ground plane. The plane
+ * fitted by depth_update is used while ground removal is enabled;
+ * otherwise it is fitted here. If no ground is in view, the grid is left
+ * unchanged.
+ *
+ * \return 1 on success, 0 otherwise (e.g. no ground plane was found)
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int depth_grid_update();
+
+/**
+ * Retrieve the distance to the nearest obstacle between two angles.
+ *
+ * \param from_angle, to_angle The sector in degrees. 0 is straight ahead,
+ *                             positive angles are to the right.
+ * \return The distance in mm, or -1 if the sector is free
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_grid_nearest_obstacle(int from_angle, int to_angle);
+
+/**
+ * Checks whether a straight path starting at the sensor is free of
+ * obstacles.
+ *
+ * \param angle The direction of the path in degrees
+ * \param length The length of the path in mm
+ * \param width The width of the path in mm
+ * \return 1 if the path is free, 0 otherwise
+ *
+ * \ingroup depth
+ */
+EXPORT_SYM int get_depth_grid_path_free(int angle, int length, int width);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,10 +33,24 @@
 
 namespace depth
 {
+  class DepthFilter;
+  
   class EXPORT_SYM DepthDriver
   {
   public:
+    /**
+     * Returns the driver set by setInstance, or the Xtion driver
+     */
     static DepthDriver &instance();
+    
+    /**
+     * Replaces the driver returned by instance(), e.g. with a
+     * RecordedDepthDriver to work without hardware. The driver is not
+     * owned.
+     *
+     * \param driver The new driver, or 0 to go back to the Xtion driver
+     */
+    static void setInstance(DepthDriver *const driver);
 
     virtual ~DepthDriver() {};
 
@@ -78,6 +92,16 @@ namespace depth
       * \return DepthImage object
       */
     virtual DepthImage *depthImage() const = 0;
+    
+    /**
+      * Runs every new frame through the filter before readers see it.
+      * The filter is not owned; set 0 before destroying it. Drivers
+      * without filter support ignore it.
+      *
+      * \param filter The filter, or 0 to get raw frames
+      */
+    virtual void setFilter(DepthFilter *const filter);
+    virtual DepthFilter *filter() const;
   };
 }
 
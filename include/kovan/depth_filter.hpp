@@ -0,0 +1,115 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file depth_filter.hpp
+ * \brief Hole filling and temporal smoothing of depth frames
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _DEPTH_FILTER_HPP_
+#define _DEPTH_FILTER_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "export.h"
+
+namespace depth
+{
+  /**
+   * Cleans up raw depth frames before they reach readers. Install it on a
+   * driver with DepthDriver::setFilter().
+   *
+   * Hole filling closes short runs of pixels without a depth value along
+   * rows, then along columns. Holes between similar depths are
+   * interpolated; holes at depth edges get the farther depth, so objects
+   * don't grow into the background.
+   *
+   * Temporal smoothing blends every pixel with its previous value, unless
+   * the depth jumped (something moved). A pixel that drops out keeps its
+   * previous value for one frame.
+   *
+   * The filter keeps per pixel state, so use one filter per driver.
+   */
+  class EXPORT_SYM DepthFilter
+  {
+  public:
+    DepthFilter();
+    
+    /**
+     * Defaults to true
+     */
+    void setHoleFill(const bool holeFill);
+    bool holeFill() const;
+    
+    /**
+     * Longer holes are left alone. Defaults to 8 pixels.
+     */
+    void setMaxHoleSize(const uint16_t pixels);
+    uint16_t maxHoleSize() const;
+    
+    /**
+     * Depths differing by more than ratio times the nearer one are
+     * different surfaces. Defaults to 0.04.
+     */
+    void setMaxStepRatio(const float ratio);
+    float maxStepRatio() const;
+    
+    /**
+     * The weight of the new frame in the temporal filter, from 0 to 1.
+     * 1 disables smoothing. Defaults to 0.5.
+     */
+    void setSmoothing(const float weight);
+    float smoothing() const;
+    
+    /**
+     * Forgets the previous frames
+     */
+    void reset();
+    
+    /**
+     * Filters a frame in place
+     *
+     * \param data width * height depth values, row by row
+     */
+    void apply(uint16_t *const data, const uint32_t width, const uint32_t height);
+    
+  private:
+    void fillRows(uint16_t *const data, const uint32_t width, const uint32_t height) const;
+    void fillColumns(uint16_t *const data, const uint32_t width, const uint32_t height);
+    void smooth(uint16_t *const data, const uint32_t size);
+    // Returns the depth filling a hole at an edge, or 0 to interpolate
+    uint16_t edgeFill(const uint16_t a, const uint16_t b) const;
+    
+    bool _holeFill;
+    uint16_t _maxHoleSize;
+    float _maxStepRatio;
+    uint32_t _weight;
+    
+    // Previous output and whether it was held over a dropout
+    std::vector<uint16_t> _previous;
+    std::vector<uint8_t> _held;
+    
+    // Last row with a depth value in every column
+    std::vector<int32_t> _lastRows;
+  };
+}
+
+#endif
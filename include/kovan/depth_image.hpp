@@ -29,10 +29,13 @@
 #define _DEPTH_IMAGE_HPP_
 
 #include <stdint.h>
+#include <vector>
 #include "geom.hpp"
 
 namespace depth
 {
+  struct DepthObject;
+  
   class EXPORT_SYM DepthImage
   {
   public:
@@ -76,10 +79,64 @@ namespace depth
     virtual uint16_t depthAt(const uint32_t row, const uint32_t column) const = 0;
     
     
+    /**
+     * Copies depth values in the sensor's memory order, ignoring the
+     * orientation.
+     *
+     * \param data Receives up to size depth values
+     * \param offset Index of the first value to copy
+     * \param size Number of values to copy
+     */
     virtual void depth(uint16_t *const data, const uint32_t offset, const uint32_t size) const = 0;
     
+    /**
+     * Copies a whole row of the image
+     *
+     * \param row The row index
+     * \param data Receives width() depth values
+     */
+    void row(const uint32_t row, uint16_t *const data) const;
+    
+    /**
+     * Copies a whole column of the image
+     *
+     * \param column The column index
+     * \param data Receives height() depth values
+     */
+    void column(const uint32_t column, uint16_t *const data) const;
+    
+    /**
+     * Copies every rowStep-th row and every columnStep-th column of the
+     * image, starting with the first
+     *
+     * \param data Receives ceil(height() / rowStep) rows of
+     *             ceil(width() / columnStep) depth values
+     */
+    void subsample(uint16_t *const data, const uint32_t rowStep, const uint32_t columnStep) const;
+    
+    /**
+     * Returns the sequence number of the frame this image was captured in
+     *
+     * \return Sequence number starting at 1, or 0 if unknown
+     */
+    virtual uint32_t frameNumber() const;
+    
+    /**
+     * Returns the time this image was captured at, as stamped by the sensor
+     *
+     * \return Seconds on the sensor's clock, or 0.0 if unknown. Only
+     *         differences between timestamps are meaningful.
+     */
+    virtual double timestamp() const;
+    
     
-    void segment();
+    /**
+     * Splits the image into objects with a default configured
+     * DepthSegmenter
+     *
+     * \param objects Receives the objects, nearest first
+     */
+    void segment(std::vector<DepthObject> &objects) const;
 
     /**
      * Returns the specified point.
@@ -89,6 +146,51 @@ namespace depth
      * \return The point or 0 if there no point at this coordinate
      */
     virtual Point3<int32_t> pointAt(const uint32_t row, const uint32_t column) const = 0;
+
+    /**
+     * Converts whole rows of the image to world coordinates. Points without
+     * a depth value are set to 0.
+     *
+     * \param points Receives width() * rows points, row by row
+     * \param row The first row to convert
+     * \param rows The number of rows to convert
+     */
+    virtual void points(Point3<int32_t> *const points, const uint32_t row, const uint32_t rows) const;
+    
+    /**
+     * Like points(), but stores the coordinates in separate arrays
+     *
+     * \param x, y, z Each receive width() * rows coordinates, row by row
+     */
+    virtual void points(int32_t *const x, int32_t *const y, int32_t *const z,
+      const uint32_t row, const uint32_t rows) const;
+    
+    /**
+     * Returns the x/z factor of every column, so a pixel's x coordinate is
+     * its depth times the factor of its column
+     *
+     * \return width() factors, or 0 if the image has no ray table
+     */
+    virtual const float *columnRays() const;
+    
+    /**
+     * Returns the y/z factor of every row
+     *
+     * \return height() factors, or 0 if the image has no ray table
+     */
+    virtual const float *rowRays() const;
+    
+  protected:
+    /**
+     * Images storing their depth values as one row major array in sensor
+     * order should return it, so row(), column() and subsample() can copy
+     * whole spans. Orientation 0 mirrors the sensor's columns, 180 flips
+     * its rows.
+     *
+     * \return The depth values, or 0 to make the span accessors fall back
+     *         to depthAt()
+     */
+    virtual const uint16_t *rawData() const;
   };
 }
 
@@ -0,0 +1,131 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file depth_segmenter.hpp
+ * \brief Connected component segmentation of depth images
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _DEPTH_SEGMENTER_HPP_
+#define _DEPTH_SEGMENTER_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "geom.hpp"
+
+namespace depth
+{
+  class DepthImage;
+  class GroundPlane;
+  
+  /**
+   * An object found by DepthSegmenter. All points are world coordinates
+   * in millimeters.
+   */
+  struct EXPORT_SYM DepthObject
+  {
+    DepthObject();
+    
+    uint32_t pixels;
+    Point3<int32_t> centroid;
+    Point3<int32_t> boundingBoxMin;
+    Point3<int32_t> boundingBoxMax;
+    Point3<int32_t> nearest;
+    
+    // Bounding box of the object's pixels in the image
+    uint32_t top;
+    uint32_t left;
+    uint32_t bottom;
+    uint32_t right;
+  };
+  
+  /**
+   * Splits a depth image into objects: 4-connected pixels whose depths
+   * differ by at most a fraction of their depth. Pixels without a depth
+   * value never belong to an object.
+   */
+  class EXPORT_SYM DepthSegmenter
+  {
+  public:
+    DepthSegmenter();
+    
+    /**
+     * Neighbouring pixels belong to the same object if their depths
+     * differ by at most ratio times the nearer depth. Defaults to 0.04.
+     */
+    void setMaxStepRatio(const float ratio);
+    float maxStepRatio() const;
+    
+    /**
+     * Objects with fewer pixels are dropped. Defaults to 50.
+     */
+    void setMinPixels(const uint32_t pixels);
+    uint32_t minPixels() const;
+    
+    /**
+     * Pixels the plane considers ground never belong to an object. The
+     * plane is not updated by the segmenter. Defaults to 0 (no ground
+     * removal).
+     */
+    void setGroundPlane(const GroundPlane *const groundPlane);
+    const GroundPlane *groundPlane() const;
+    
+    /**
+     * Segments the image
+     *
+     * \param objects Receives the objects, nearest first
+     */
+    void segment(const DepthImage &image, std::vector<DepthObject> &objects);
+    
+  private:
+    struct Stats
+    {
+      uint32_t pixels;
+      int64_t sumX;
+      int64_t sumY;
+      int64_t sumZ;
+      int32_t minX, minY, minZ;
+      int32_t maxX, maxY, maxZ;
+      uint32_t nearest;
+      uint32_t top, left, bottom, right;
+    };
+    
+    uint32_t find(uint32_t label);
+    uint32_t unite(const uint32_t a, const uint32_t b);
+    bool connected(const uint16_t a, const uint16_t b) const;
+    
+    float _maxStepRatio;
+    uint32_t _minPixels;
+    const GroundPlane *_groundPlane;
+    
+    // Scratch space reused between frames
+    std::vector<uint16_t> _depths;
+    std::vector<uint32_t> _labels;
+    std::vector<uint32_t> _parents;
+    std::vector<uint32_t> _components;
+    std::vector<int32_t> _x;
+    std::vector<int32_t> _y;
+    std::vector<int32_t> _z;
+    std::vector<Stats> _stats;
+  };
+}
+
+#endif
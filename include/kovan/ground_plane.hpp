@@ -0,0 +1,165 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file ground_plane.hpp
+ * \brief Ground plane estimation for depth images
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _GROUND_PLANE_HPP_
+#define _GROUND_PLANE_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "geom.hpp"
+
+namespace depth
+{
+  class DepthImage;
+  
+  /**
+   * Estimates the ground plane of depth images. The first fit is a RANSAC
+   * search over a subsampled point cloud; following frames refit the
+   * previous plane by least squares on its inliers and only fall back to
+   * RANSAC when the plane is lost.
+   *
+   * The plane is stored as the unit normal pointing away from the ground
+   * and the camera's height above it, both in world coordinates (mm).
+   */
+  class EXPORT_SYM GroundPlane
+  {
+  public:
+    GroundPlane();
+    
+    /**
+     * Only every step-th row and column is sampled for fitting. Defaults
+     * to 4.
+     */
+    void setSampleStep(const uint32_t step);
+    uint32_t sampleStep() const;
+    
+    /**
+     * Points closer than this to the plane (in mm) count as inliers while
+     * fitting. Defaults to 20.
+     */
+    void setInlierDistance(const uint16_t distance);
+    uint16_t inlierDistance() const;
+    
+    /**
+     * Points less than this high above the plane (in mm) are ground.
+     * Defaults to 30.
+     */
+    void setGroundHeight(const uint16_t height);
+    uint16_t groundHeight() const;
+    
+    /**
+     * A plane is only accepted if at least this fraction of the sampled
+     * points lie on it. Defaults to 0.2.
+     */
+    void setMinInlierRatio(const float ratio);
+    float minInlierRatio() const;
+    
+    /**
+     * Fits the plane to the image, starting from the previous estimate
+     *
+     * \return true if a plane was found
+     */
+    bool update(const DepthImage &image);
+    
+    /**
+     * Forgets the current estimate, so the next update starts from scratch
+     */
+    void reset();
+    
+    bool isValid() const;
+    
+    /**
+     * \return The unit normal of the plane, pointing towards the camera
+     */
+    Point3<float> normal() const;
+    
+    /**
+     * \return The height of the camera above the plane in mm
+     */
+    float cameraHeight() const;
+    
+    /**
+     * \return The height of a world point above the plane in mm
+     */
+    float height(const Point3<int32_t> &point) const;
+    
+    /**
+     * \return true if a valid plane exists and the point is less than
+     *         groundHeight() above it
+     */
+    bool isGround(const Point3<int32_t> &point) const;
+    
+    /**
+     * Computes the height above ground of whole rows of the image. Pixels
+     * without a depth value and all pixels while there is no valid plane
+     * are set to -32768.
+     *
+     * \param heights Receives width() * rows heights in mm, row by row
+     */
+    void heights(const DepthImage &image, int16_t *const heights,
+      const uint32_t row, const uint32_t rows);
+    
+    /**
+     * Computes the ground mask of whole rows of the image
+     *
+     * \param mask Receives width() * rows values, row by row: 1 for ground
+     *             pixels, 0 for all others (including pixels without a
+     *             depth value)
+     */
+    void mask(const DepthImage &image, uint8_t *const mask,
+      const uint32_t row, const uint32_t rows);
+    
+  private:
+    uint32_t inliers(const float nx, const float ny, const float nz, const float d) const;
+    bool ransac(const uint32_t minInliers);
+    bool refit(const uint32_t minInliers);
+    void convert(const DepthImage &image, const uint32_t row, const uint32_t rows);
+    uint32_t random();
+    
+    uint32_t _sampleStep;
+    uint16_t _inlierDistance;
+    uint16_t _groundHeight;
+    float _minInlierRatio;
+    
+    bool _valid;
+    float _nx;
+    float _ny;
+    float _nz;
+    float _d;
+    
+    uint32_t _seed;
+    
+    // Scratch space reused between frames
+    std::vector<float> _sx;
+    std::vector<float> _sy;
+    std::vector<float> _sz;
+    std::vector<int32_t> _x;
+    std::vector<int32_t> _y;
+    std::vector<int32_t> _z;
+  };
+}
+
+#endif
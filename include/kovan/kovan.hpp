@@ -48,6 +48,11 @@
 #include "sensor_logic.hpp"
 #include "button.hpp"
 #include "camera.hpp"
+#include "object_tracker.hpp"
+#include "v4l2_input_provider.hpp"
+#include "recorded_input_provider.hpp"
+#include "rgbd_input_provider.hpp"
+#include "camera_profiler.hpp"
 #include "ir.hpp"
 #include "wifi.hpp"
 #include "battery.hpp"
@@ -61,5 +66,14 @@
 #include "thread.hpp"
 #include "depth_driver.hpp"
 #include "depth_image.hpp"
+#include "sensor_depth_image.hpp"
+#include "depth_segmenter.hpp"
+#include "ground_plane.hpp"
+#include "occupancy_grid.hpp"
+#include "recorded_depth_image.hpp"
+#include "recorded_depth_driver.hpp"
+#include "depth_filter.hpp"
+#include "rgbd_frame.hpp"
+#include "rgbd_source.hpp"
 
 #endif
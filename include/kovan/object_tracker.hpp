@@ -0,0 +1,181 @@
+/**************************************************************************
+ *  Copyright 2012 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+#ifndef _OBJECT_TRACKER_HPP_
+#define _OBJECT_TRACKER_HPP_
+
+/*!
+ * \file object_tracker.hpp
+ * \brief Associates a channel's objects across camera frames.
+ * \copyright KISS Insitute for Practical Robotics
+ * \ingroup camera
+ */
+
+#include "camera.hpp"
+#include "geom.hpp"
+#include "export.h"
+
+#include <vector>
+
+namespace Camera
+{
+	class EXPORT_SYM TrackedObject
+	{
+	public:
+		TrackedObject(const unsigned id, const Object &object);
+		
+		/**
+		 * An id that stays the same for as long as the object is tracked.
+		 */
+		unsigned id() const;
+		
+		/**
+		 * The smoothed centroid of the object.
+		 */
+		Point2<unsigned> centroid() const;
+		
+		/**
+		 * The centroid the object is expected to have next frame.
+		 */
+		Point2<unsigned> predictedCentroid() const;
+		
+		/**
+		 * The most recently observed bounding box.
+		 */
+		const Rect<unsigned> &boundingBox() const;
+		
+		/**
+		 * The estimated motion in pixels per frame.
+		 */
+		double velocityX() const;
+		double velocityY() const;
+		
+		/**
+		 * Number of frames this object was observed in.
+		 */
+		unsigned hits() const;
+		
+		/**
+		 * Number of consecutive frames this object wasn't observed in.
+		 * The centroid of an object that is missing is predicted.
+		 */
+		unsigned missed() const;
+		
+		bool isConfident() const;
+		
+	private:
+		friend class ObjectTracker;
+		
+		void predict();
+		void correct(const Object &object, const double alpha, const double beta);
+		
+		unsigned m_id;
+		double m_x;
+		double m_y;
+		double m_vx;
+		double m_vy;
+		Rect<unsigned> m_boundingBox;
+		unsigned m_hits;
+		unsigned m_missed;
+	};
+	
+	typedef std::vector<TrackedObject> TrackedObjectVector;
+	
+	/**
+	 * Keeps stable ids for the objects of a Channel.
+	 * Call update() once after every Device::update().
+	 */
+	class EXPORT_SYM ObjectTracker
+	{
+	public:
+		ObjectTracker(Channel *const channel);
+		
+		/**
+		 * Pulls the channel's objects for the current frame and matches
+		 * them to the tracked objects.
+		 */
+		void update();
+		
+		/**
+		 * Forgets all tracked objects.
+		 */
+		void reset();
+		
+		/**
+		 * The tracked objects, oldest first.
+		 */
+		const TrackedObjectVector &objects() const;
+		
+		/**
+		 * \return the object with the given id, or 0 if it isn't tracked anymore.
+		 */
+		const TrackedObject *object(const unsigned id) const;
+		
+		/**
+		 * Observations farther than distance pixels from a prediction
+		 * start a new track. Defaults to 40.
+		 */
+		void setMaxDistance(const unsigned distance);
+		unsigned maxDistance() const;
+		
+		/**
+		 * Tracks are dropped after missing for more than frames frames.
+		 * Defaults to 5.
+		 */
+		void setMaxMissed(const unsigned frames);
+		unsigned maxMissed() const;
+		
+		/**
+		 * Gains of the alpha-beta filter smoothing position and velocity.
+		 * Defaults to 0.5 and 0.1.
+		 */
+		void setSmoothing(const double alpha, const double beta);
+		
+		/**
+		 * When enabled and every track is confident, the channel only searches
+		 * around the predicted positions next frame. A full search is still
+		 * done every refreshInterval frames to pick up new objects.
+		 */
+		void setSeedSearchWindow(const bool seed, const unsigned refreshInterval = 15);
+		bool seedSearchWindow() const;
+		
+		Channel *channel() const;
+		
+	private:
+		void seed();
+		
+		Channel *const m_channel;
+		TrackedObjectVector m_objects;
+		unsigned m_nextId;
+		unsigned m_maxDistance;
+		unsigned m_maxMissed;
+		double m_alpha;
+		double m_beta;
+		bool m_seed;
+		unsigned m_refreshInterval;
+		unsigned m_sinceRefresh;
+		
+		// Scratch space reused between frames
+		std::vector<bool> m_matched;
+		std::vector<std::pair<unsigned, std::pair<unsigned, unsigned> > > m_candidates;
+	};
+}
+
+#endif
@@ -0,0 +1,186 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file occupancy_grid.hpp
+ * \brief A 2D obstacle map built from depth images
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _OCCUPANCY_GRID_HPP_
+#define _OCCUPANCY_GRID_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "geom.hpp"
+
+namespace depth
+{
+  class DepthImage;
+  class GroundPlane;
+  
+  /**
+   * A top down obstacle map in front of the depth camera. Every cell
+   * covers a square on the x/z plane of the world coordinates; columns run
+   * along x centered on the camera, rows along z away from it.
+   *
+   * Each update() raises the value of cells containing enough points in
+   * the height band and lowers all others, so single noisy frames don't
+   * flip cells. Cells at or above the occupied threshold are obstacles.
+   *
+   * Angles are in degrees, 0 is straight ahead (+z) and positive angles
+   * turn towards +x. Distances are in mm.
+   */
+  class EXPORT_SYM OccupancyGrid
+  {
+  public:
+    OccupancyGrid();
+    
+    /**
+     * Resizes and clears the grid. Defaults to 64 x 64 cells of 50 mm.
+     */
+    void setSize(const uint32_t columns, const uint32_t rows);
+    uint32_t columns() const;
+    uint32_t rows() const;
+    
+    void setCellSize(const uint16_t cellSize);
+    uint16_t cellSize() const;
+    
+    /**
+     * Only points with a height in [minimum, maximum) are obstacles. The
+     * height is measured above the ground plane if a valid one is set,
+     * otherwise above a level floor cameraHeight() below the camera.
+     * Defaults to 50 - 1000 mm.
+     */
+    void setHeightBand(const int16_t minimum, const int16_t maximum);
+    int16_t minimumHeight() const;
+    int16_t maximumHeight() const;
+    
+    /**
+     * Defaults to 0 (heights above a level floor, see setCameraHeight).
+     * The plane is not updated by the grid.
+     */
+    void setGroundPlane(const GroundPlane *const groundPlane);
+    const GroundPlane *groundPlane() const;
+    
+    /**
+     * The camera's height above the floor in mm, used while there is no
+     * valid ground plane. Heights are then cameraHeight() minus the
+     * point's y coordinate, which grows upwards. Defaults to 0, so
+     * without a plane only points above the camera can be obstacles.
+     */
+    void setCameraHeight(const uint16_t height);
+    uint16_t cameraHeight() const;
+    
+    /**
+     * Only every step-th row and column of the image is projected.
+     * Defaults to 2.
+     */
+    void setSampleStep(const uint32_t step);
+    uint32_t sampleStep() const;
+    
+    /**
+     * A cell needs at least this many points in one frame to be hit.
+     * Defaults to 2.
+     */
+    void setMinPoints(const uint16_t points);
+    uint16_t minPoints() const;
+    
+    /**
+     * Hit cells gain hitIncrement, all others lose missDecrement, clamped
+     * to 0 - 255. Cells are occupied at occupiedThreshold. Defaults to
+     * 96, 48 and 128, so a cell is occupied after two consecutive hits
+     * and cleared after three misses.
+     */
+    void setUpdateRates(const uint8_t hitIncrement, const uint8_t missDecrement,
+      const uint8_t occupiedThreshold);
+    
+    /**
+     * Projects the image into the grid
+     */
+    void update(const DepthImage &image);
+    
+    /**
+     * Sets every cell to 0
+     */
+    void clear();
+    
+    uint8_t value(const uint32_t column, const uint32_t row) const;
+    bool isOccupied(const uint32_t column, const uint32_t row) const;
+    
+    /**
+     * \return columns() * rows() cell values, row by row starting nearest
+     *         to the camera
+     */
+    const uint8_t *data() const;
+    
+    /**
+     * \return The world coordinates of a cell's center on the x/z plane
+     */
+    Point2<int32_t> cellCenter(const uint32_t column, const uint32_t row) const;
+    
+    /**
+     * Finds the nearest occupied cell whose center lies between two
+     * angles
+     *
+     * \param center If given, receives the cell's center
+     * \return Distance to the cell's center, or -1 if the sector is free
+     */
+    int32_t nearestObstacle(const float fromAngle, const float toAngle,
+      Point2<int32_t> *const center = 0) const;
+    
+    /**
+     * Checks a straight corridor starting at the camera
+     *
+     * \param angle Direction of the corridor
+     * \param length Length of the corridor
+     * \param width Width of the corridor, e.g. the robot's width
+     * \return true if no occupied cell overlaps the corridor
+     */
+    bool isPathFree(const float angle, const uint32_t length, const uint32_t width) const;
+    
+  private:
+    uint32_t _columns;
+    uint32_t _rows;
+    uint16_t _cellSize;
+    int16_t _minimumHeight;
+    int16_t _maximumHeight;
+    const GroundPlane *_groundPlane;
+    uint16_t _cameraHeight;
+    uint32_t _sampleStep;
+    uint16_t _minPoints;
+    uint8_t _hitIncrement;
+    uint8_t _missDecrement;
+    uint8_t _occupiedThreshold;
+    
+    std::vector<uint8_t> _cells;
+    
+    // Indices of the occupied cells, so queries skip free space
+    std::vector<uint32_t> _occupied;
+    
+    // Scratch space reused between frames
+    std::vector<uint16_t> _hits;
+    std::vector<int32_t> _x;
+    std::vector<int32_t> _y;
+    std::vector<int32_t> _z;
+  };
+}
+
+#endif
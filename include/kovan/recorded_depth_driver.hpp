@@ -0,0 +1,152 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file recorded_depth_driver.hpp
+ * \brief Recording and replay of depth frames
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _RECORDED_DEPTH_DRIVER_HPP_
+#define _RECORDED_DEPTH_DRIVER_HPP_
+
+#include "depth_driver.hpp"
+#include "recorded_depth_image.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace depth
+{
+  /**
+   * Writes depth images to a file RecordedDepthDriver can replay. Frames
+   * are stored as raw 16 bit depth values in sensor order, optionally
+   * zlib compressed. All frames of a recording must have the same size.
+   */
+  class EXPORT_SYM DepthRecorder
+  {
+  public:
+    DepthRecorder();
+    ~DepthRecorder();
+    
+    /**
+     * \param compress If true, every frame is zlib compressed. Depth
+     *                 frames typically shrink to a third, at the cost of
+     *                 some CPU time while recording and replaying.
+     */
+    bool open(const std::string &path, const bool compress = false);
+    bool isOpen() const;
+    bool write(const DepthImage &image);
+    bool close();
+    
+    uint32_t frameCount() const;
+    
+  private:
+    std::ofstream _file;
+    bool _compress;
+    uint32_t _width;
+    uint32_t _height;
+    uint32_t _frames;
+    
+    // Scratch space reused between frames
+    std::vector<uint16_t> _data;
+    std::vector<unsigned char> _compressed;
+  };
+  
+  /**
+   * Replays a recording made by DepthRecorder. Install it with
+   * DepthDriver::setInstance() to run the depth pipeline without
+   * hardware.
+   */
+  class EXPORT_SYM RecordedDepthDriver : public DepthDriver
+  {
+  public:
+    RecordedDepthDriver(const std::string &path);
+    virtual ~RecordedDepthDriver();
+    
+    /**
+     * Opens the recording
+     *
+     * \throw Exception if the file isn't a readable recording
+     */
+    virtual void open();
+    virtual void close();
+    virtual bool isOpen() const;
+    
+    virtual DepthResolution depthCameraResolution() const;
+    
+    /**
+     * \throw Exception if the resolution differs from the recorded one
+     */
+    virtual void setDepthCameraResolution(const DepthResolution resolution);
+    
+    /**
+     * Returns the current frame of the recording. Without a frame rate,
+     * every call returns the next frame.
+     *
+     * \return The frame, or 0 after the last frame unless looping
+     */
+    virtual DepthImage *depthImage() const;
+    
+    /**
+     * Filters every frame as it is read from the file
+     */
+    virtual void setFilter(DepthFilter *const filter);
+    virtual DepthFilter *filter() const;
+    
+    /**
+     * Replays the recording in real time at the given rate, so repeated
+     * calls to depthImage() return the same frame until the next one is
+     * due. Defaults to 0 (no timing, for benchmarks).
+     */
+    void setFrameRate(const double fps);
+    double frameRate() const;
+    
+    /**
+     * Defaults to false
+     */
+    void setLoop(const bool loop);
+    bool loop() const;
+    
+    uint32_t frameCount() const;
+    
+  private:
+    bool read(const uint32_t frame) const;
+    
+    std::string _path;
+    double _fps;
+    bool _loop;
+    bool _compressed;
+    DepthFilter *_filter;
+    
+    // File offset of every frame
+    std::vector<std::streamoff> _offsets;
+    
+    mutable std::ifstream _file;
+    mutable RecordedDepthImage _image;
+    mutable int64_t _current;
+    mutable uint32_t _next;
+    mutable double _start;
+    mutable std::vector<unsigned char> _buffer;
+  };
+}
+
+#endif
@@ -0,0 +1,63 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file recorded_depth_image.hpp
+ * \brief A depth image replayed from a recording
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _RECORDED_DEPTH_IMAGE_HPP_
+#define _RECORDED_DEPTH_IMAGE_HPP_
+
+#include "sensor_depth_image.hpp"
+
+#include <vector>
+
+namespace depth
+{
+  class RecordedDepthDriver;
+  
+  /**
+   * A frame of a recording made by DepthRecorder. Depth values are kept
+   * in the recorded sensor order and oriented like XtionDepthImage.
+   */
+  class EXPORT_SYM RecordedDepthImage : public SensorDepthImage
+  {
+  public:
+    RecordedDepthImage();
+    virtual ~RecordedDepthImage();
+    
+  private:
+    friend class RecordedDepthDriver;
+    
+    RecordedDepthImage(const RecordedDepthImage &rhs);
+    RecordedDepthImage &operator =(const RecordedDepthImage &rhs);
+    
+    // Allocates the buffers for a recording and points the image at them
+    void resize(const uint32_t width, const uint32_t height);
+    
+    std::vector<uint16_t> _depths;
+    std::vector<float> _columns;
+    std::vector<float> _rows;
+  };
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+#ifndef _RECORDED_INPUT_PROVIDER_HPP_
+#define _RECORDED_INPUT_PROVIDER_HPP_
+
+#include "camera.hpp"
+#include "export.h"
+
+#include <string>
+#include <fstream>
+
+namespace Camera
+{
+	/**
+	 * Writes every frame it is given to a raw BGR dump that
+	 * RecordedInputProvider can replay. All frames of a recording must have
+	 * the size of the first one.
+	 * \see Device::setRecorder
+	 */
+	class EXPORT_SYM FrameRecorder
+	{
+	public:
+		FrameRecorder();
+		~FrameRecorder();
+		
+		bool open(const std::string &path);
+		bool isOpen() const;
+		bool write(const cv::Mat &image);
+		bool close();
+		
+		unsigned frameCount() const;
+		
+	private:
+		FrameRecorder(const FrameRecorder &rhs);
+		FrameRecorder &operator =(const FrameRecorder &rhs);
+		
+		std::ofstream m_file;
+		unsigned m_width;
+		unsigned m_height;
+		unsigned m_frames;
+	};
+	
+	/**
+	 * Replays a raw BGR dump written by FrameRecorder, or any video file
+	 * OpenCV can read, through a Camera::Device.
+	 */
+	class EXPORT_SYM RecordedInputProvider : public InputProvider
+	{
+	public:
+		RecordedInputProvider(const std::string &path);
+		~RecordedInputProvider();
+		
+		/**
+		 * number is ignored; the recording is opened from the start.
+		 */
+		virtual bool open(const int number);
+		virtual bool isOpen() const;
+		
+		/**
+		 * Frames are scaled to the given size. 0, the default, keeps the
+		 * recorded size.
+		 */
+		virtual void setWidth(const unsigned width);
+		virtual void setHeight(const unsigned height);
+		virtual bool next(cv::Mat &image);
+		virtual bool close();
+		
+		/**
+		 * next() blocks so frames are delivered at the given rate.
+		 * 0, the default, delivers them as fast as possible.
+		 */
+		void setFrameRate(const double fps);
+		double frameRate() const;
+		
+		/**
+		 * Restart from the first frame at the end of the recording instead
+		 * of failing. Disabled by default.
+		 */
+		void setLoop(const bool loop);
+		bool loop() const;
+		
+	private:
+		bool rewind();
+		bool read(cv::Mat &image);
+		
+		std::string m_path;
+		std::ifstream m_file;
+		cv::VideoCapture *m_capture;
+		unsigned m_recordedWidth;
+		unsigned m_recordedHeight;
+		
+		unsigned m_width;
+		unsigned m_height;
+		double m_fps;
+		bool m_loop;
+		long long m_lastTick;
+	};
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file rgbd_frame.hpp
+ * \brief Synchronized color and depth frames
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _RGBD_FRAME_HPP_
+#define _RGBD_FRAME_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "geom.hpp"
+#include "thread.hpp"
+
+namespace depth
+{
+  /**
+   * A color frame and the depth frame registered to it, so both share
+   * their pixel coordinates. World coordinates are in mm, relative to the
+   * color camera.
+   *
+   * The buffers are in sensor order, while rows and columns passed to
+   * pointAt are oriented like a DepthImage of the given orientation.
+   */
+  struct EXPORT_SYM RgbdFrame
+  {
+    RgbdFrame();
+    
+    /**
+     * \return The world coordinates of a pixel, or false if it has no
+     *         depth value
+     */
+    bool pointAt(const uint32_t row, const uint32_t column, Point3<int32_t> &point) const;
+    
+    /**
+     * Looks up the depth of a window through the median of its depth
+     * values, so a few stray background pixels don't matter
+     *
+     * \return The world coordinates of the window's center at the median
+     *         depth, or false if the window has no depth values
+     */
+    bool pointAt(const Rect<unsigned> &window, Point3<int32_t> &point) const;
+    
+    uint32_t width;
+    uint32_t height;
+    
+    // width * height packed BGR pixels and depth values, row by row
+    std::vector<uint8_t> color;
+    std::vector<uint16_t> depth;
+    
+    // x/z factor of every column and y/z factor of every row
+    std::vector<float> columnRays;
+    std::vector<float> rowRays;
+    
+    // Device time in microseconds
+    uint64_t colorTimestamp;
+    uint64_t depthTimestamp;
+    
+    uint32_t frameNumber;
+    
+    // See set_depth_orientation
+    uint16_t orientation;
+  };
+  
+  /**
+   * Pairs color and depth frames arriving independently, e.g. from two
+   * OpenNI streams. Every depth frame is matched with the color frame
+   * closest in time. Safe to use from multiple threads.
+   */
+  class EXPORT_SYM RgbdPairer
+  {
+  public:
+    RgbdPairer();
+    
+    /**
+     * Frames further apart are never paired. Defaults to 16000 us, half
+     * a frame at 30 fps.
+     */
+    void setMaxSkew(const uint64_t microseconds);
+    uint64_t maxSkew() const;
+    
+    /**
+     * Copies a color frame
+     *
+     * \param rgb true if data is RGB instead of BGR
+     */
+    void pushColor(const uint8_t *const data, const uint32_t width, const uint32_t height,
+      const uint64_t timestamp, const bool rgb = false);
+    
+    /**
+     * Copies a depth frame, replacing an unpaired older one
+     */
+    void pushDepth(const uint16_t *const data, const uint32_t width, const uint32_t height,
+      const uint64_t timestamp);
+    
+    /**
+     * Hands out the newest depth frame with its color frame. Both are
+     * consumed. The frame's buffers are swapped in, so taking frames
+     * doesn't allocate once sizes are stable. Rays are left untouched.
+     *
+     * \return false if there is no new depth frame with a matching color
+     *         frame (yet)
+     */
+    bool take(RgbdFrame &frame);
+    
+    void clear();
+    
+  private:
+    enum { ColorHistory = 4 };
+    
+    struct Color
+    {
+      Color();
+      
+      std::vector<uint8_t> data;
+      uint32_t width;
+      uint32_t height;
+      uint64_t timestamp;
+      bool valid;
+    };
+    
+    uint64_t _maxSkew;
+    Color _colors[ColorHistory];
+    uint32_t _nextColor;
+    
+    std::vector<uint16_t> _depth;
+    uint32_t _depthWidth;
+    uint32_t _depthHeight;
+    uint64_t _depthTimestamp;
+    bool _depthValid;
+    
+    uint32_t _frameNumber;
+    mutable Mutex _mutex;
+  };
+}
+
+#endif
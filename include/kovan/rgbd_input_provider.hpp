@@ -0,0 +1,71 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+#ifndef _RGBD_INPUT_PROVIDER_HPP_
+#define _RGBD_INPUT_PROVIDER_HPP_
+
+#include "camera.hpp"
+#include "rgbd_source.hpp"
+#include "export.h"
+
+namespace Camera
+{
+	/**
+	 * Feeds the color half of an RGB-D source to the camera, keeping the
+	 * registered depth frame around so blobs found in color can be located
+	 * in 3D.
+	 * \see Device::worldCentroid
+	 */
+	class EXPORT_SYM RgbdInputProvider : public InputProvider
+	{
+	public:
+		/**
+		 * Takes ownership of the source
+		 */
+		RgbdInputProvider(depth::RgbdSource *const source = new depth::XtionRgbdSource);
+		~RgbdInputProvider();
+		
+		virtual bool open(const int number);
+		virtual bool isOpen() const;
+		virtual void setWidth(const unsigned width);
+		virtual void setHeight(const unsigned height);
+		virtual bool next(cv::Mat &image);
+		virtual bool close();
+		virtual bool worldPoint(const Rect<unsigned> &window, Point3<int32_t> &point) const;
+		
+		depth::RgbdSource *source() const;
+		
+		/**
+		 * The frame pair the last image came from
+		 */
+		const depth::RgbdFrame &frame() const;
+		
+	private:
+		RgbdInputProvider(const RgbdInputProvider &rhs);
+		RgbdInputProvider &operator =(const RgbdInputProvider &rhs);
+		
+		depth::RgbdSource *m_source;
+		depth::RgbdFrame m_frame;
+		unsigned m_width;
+		unsigned m_height;
+	};
+}
+
+#endif
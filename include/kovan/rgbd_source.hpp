@@ -0,0 +1,158 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file rgbd_source.hpp
+ * \brief Sources of synchronized color and depth frames
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _RGBD_SOURCE_HPP_
+#define _RGBD_SOURCE_HPP_
+
+#include "rgbd_frame.hpp"
+
+namespace depth
+{
+  class EXPORT_SYM RgbdSource
+  {
+  public:
+    virtual ~RgbdSource();
+    
+    virtual bool open() = 0;
+    virtual bool isOpen() const = 0;
+    virtual bool close() = 0;
+    
+    /**
+     * Fetches the next synchronized frame pair
+     *
+     * \return false if there is no new pair
+     */
+    virtual bool next(RgbdFrame &frame) = 0;
+  };
+  
+  /**
+   * Color and depth from the Xtion, registered and synchronized in
+   * hardware. Enables the color stream of XtionDepthDriver, so the depth
+   * API keeps working alongside. Frames are oriented like the depth API's
+   * images, see set_depth_orientation.
+   */
+  class EXPORT_SYM XtionRgbdSource : public RgbdSource
+  {
+  public:
+    XtionRgbdSource();
+    virtual ~XtionRgbdSource();
+    
+    virtual bool open();
+    virtual bool isOpen() const;
+    
+    /**
+     * Only stops what open() started: the color stream if it enabled it,
+     * the driver if it opened it. Also resets the source if the driver
+     * was already closed elsewhere.
+     */
+    virtual bool close();
+    virtual bool next(RgbdFrame &frame);
+    
+  private:
+    bool _open;
+    bool _openedDriver;
+    bool _enabledColor;
+  };
+  
+  /**
+   * Renders colored boxes at fixed depths in process, and pairs them
+   * through an RgbdPairer like the Xtion does. Lets the color/depth
+   * pairing and depth lookups be exercised without a sensor.
+   */
+  class EXPORT_SYM SyntheticRgbdSource : public RgbdSource
+  {
+  public:
+    SyntheticRgbdSource(const uint32_t width = 160, const uint32_t height = 120);
+    
+    virtual bool open();
+    virtual bool isOpen() const;
+    virtual bool close();
+    virtual bool next(RgbdFrame &frame);
+    
+    /**
+     * Sets the color and depth of pixels not covered by a box. Defaults
+     * to black without depth.
+     */
+    void setBackground(const uint8_t blue, const uint8_t green, const uint8_t red,
+      const uint16_t depth);
+    
+    /**
+     * Adds a box covering the given oriented pixels (bottom and right
+     * excluded). Later boxes are drawn over earlier ones.
+     */
+    void addBox(const Rect<unsigned> &pixels, const uint8_t blue, const uint8_t green,
+      const uint8_t red, const uint16_t depth);
+    void clearBoxes();
+    
+    /**
+     * Time between frames. Defaults to 33333 us (30 fps).
+     */
+    void setFramePeriod(const uint64_t microseconds);
+    
+    /**
+     * Shifts the depth timestamps against the color ones, like two
+     * unsynchronized streams would. Defaults to 0.
+     */
+    void setDepthDelay(const int64_t microseconds);
+    
+    /**
+     * The orientation of the frames. Boxes are placed in oriented
+     * coordinates. Defaults to 0.
+     */
+    void setOrientation(const uint16_t orientation);
+    
+    RgbdPairer *pairer();
+    
+  private:
+    struct Box
+    {
+      Rect<unsigned> pixels;
+      uint8_t bgr[3];
+      uint16_t depth;
+    };
+    
+    void render();
+    
+    uint32_t _width;
+    uint32_t _height;
+    bool _open;
+    uint8_t _background[3];
+    uint16_t _backgroundDepth;
+    std::vector<Box> _boxes;
+    uint64_t _framePeriod;
+    int64_t _depthDelay;
+    uint64_t _time;
+    uint16_t _orientation;
+    
+    RgbdPairer _pairer;
+    std::vector<uint8_t> _color;
+    std::vector<uint16_t> _depth;
+    std::vector<float> _columnRays;
+    std::vector<float> _rowRays;
+  };
+}
+
+#endif
@@ -0,0 +1,103 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+/**
+ * \file sensor_depth_image.hpp
+ * \brief A depth image kept in the Xtion's sensor order
+ * \copyright KISS Insitute for Practical Robotics
+ */
+
+#ifndef _SENSOR_DEPTH_IMAGE_HPP_
+#define _SENSOR_DEPTH_IMAGE_HPP_
+
+#include "depth_image.hpp"
+#include "geom.hpp"
+
+namespace depth
+{
+  /**
+   * A depth image stored as one row major array in the Xtion's sensor
+   * order, converted to world coordinates through per column and per row
+   * ray tables. The data and the tables are not owned.
+   */
+  class EXPORT_SYM SensorDepthImage : public DepthImage
+  {
+  public:
+    // The Xtion's center is offset by this many mm from its depth sensor
+    enum { CenterOffset = 44 };
+    
+    virtual ~SensorDepthImage();
+    
+    virtual void setOrientation(const uint16_t orientation);
+    virtual uint16_t orientation() const;
+    virtual uint32_t height() const;
+    virtual uint32_t width() const;
+    virtual uint16_t depthAt(const uint32_t row, const uint32_t column) const;
+    virtual void depth(uint16_t *const data, const uint32_t offset, const uint32_t size) const;
+    virtual uint32_t frameNumber() const;
+    virtual double timestamp() const;
+    
+    /**
+     * Requires the ray tables
+     */
+    virtual Point3<int32_t> pointAt(const uint32_t row, const uint32_t column) const;
+    
+    virtual void points(Point3<int32_t> *const points, const uint32_t row, const uint32_t rows) const;
+    virtual void points(int32_t *const x, int32_t *const y, int32_t *const z,
+      const uint32_t row, const uint32_t rows) const;
+    
+    virtual const float *columnRays() const;
+    virtual const float *rowRays() const;
+    
+    /**
+     * Returns the sensor order index of an oriented pixel. Orientation 0
+     * mirrors the sensor's columns, any other orientation flips its rows.
+     */
+    static uint32_t index(const uint32_t width, const uint32_t height,
+      const uint16_t orientation, const uint32_t row, const uint32_t column);
+    
+  protected:
+    SensorDepthImage(const uint16_t *const data, const uint32_t width, const uint32_t height,
+      const uint16_t orientation, const uint32_t frameNumber, const double timestamp,
+      const float *const columnRays, const float *const rowRays);
+    
+    virtual const uint16_t *rawData() const;
+    
+    const uint16_t *_data;
+    uint32_t _width;
+    uint32_t _height;
+    uint16_t _orientation;
+    uint32_t _frameNumber;
+    double _timestamp;
+    
+    // x/z factor of every column and y/z factor of every row
+    const float *_columnRays;
+    const float *_rowRays;
+    
+  private:
+    uint32_t index(const uint32_t row, const uint32_t column) const;
+    
+    // Sensor order address of an oriented row's column 0. See index()
+    // for the direction its columns run in.
+    const uint16_t *rowData(const uint32_t row) const;
+  };
+}
+
+#endif
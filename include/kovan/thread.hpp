@@ -24,6 +24,8 @@ public:
 	
 private:
 	Mutex(const Mutex &rhs);
+	
+	friend class Condition;
 
 #ifdef WIN32
 	CRITICAL_SECTION m_handle;
@@ -32,13 +34,40 @@ private:
 #endif
 };
 
+/**
+ * A condition variable. wait() must be called with the mutex locked, and
+ * may return spuriously, so always wait in a loop checking the condition.
+ */
+class EXPORT_SYM Condition
+{
+public:
+	Condition();
+	~Condition();
+	
+	void wait(Mutex &mutex);
+	void signal();
+	void broadcast();
+	
+private:
+	Condition(const Condition &rhs);
+	
+#ifdef WIN32
+	CONDITION_VARIABLE m_handle;
+#else
+	pthread_cond_t m_handle;
+#endif
+};
+
 class EXPORT_SYM Thread
 {
 public:
 	Thread();
 	virtual ~Thread();
 	
-	void start();
+	/**
+	 * \return false if the thread couldn't be created
+	 */
+	bool start();
 	void join();
 	
 	virtual void run() = 0;
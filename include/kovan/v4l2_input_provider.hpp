@@ -0,0 +1,117 @@
+/**************************************************************************
+ *  Copyright 2013 KISS Institute for Practical Robotics                  *
+ *                                                                        *
+ *  This file is part of libkovan.                                        *
+ *                                                                        *
+ *  libkovan is free software: you can redistribute it and/or modify      *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 2 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  libkovan is distributed in the hope that it will be useful,           *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with libkovan. Check the LICENSE file in the project root.      *
+ *  If not, see <http://www.gnu.org/licenses/>.                           *
+ **************************************************************************/
+
+#ifdef __linux__
+
+#ifndef _V4L2_INPUT_PROVIDER_HPP_
+#define _V4L2_INPUT_PROVIDER_HPP_
+
+#include "camera.hpp"
+#include "export.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace Camera
+{
+	/**
+	 * Captures straight from a Video4Linux2 device through memory mapped
+	 * driver buffers. Unlike UsbInputProvider, there is no additional
+	 * buffering between the driver and next(): YUYV frames are converted
+	 * directly from the mapped buffer into the BGR image the channels use,
+	 * MJPEG frames are decoded from it.
+	 */
+	class EXPORT_SYM V4L2InputProvider : public InputProvider
+	{
+	public:
+		enum PixelFormat
+		{
+			Yuyv,
+			Mjpeg
+		};
+		
+		V4L2InputProvider(const PixelFormat pixelFormat = Yuyv);
+		~V4L2InputProvider();
+		
+		/**
+		 * Opens /dev/video<number>
+		 */
+		virtual bool open(const int number);
+		virtual bool isOpen() const;
+		virtual void setWidth(const unsigned width);
+		virtual void setHeight(const unsigned height);
+		virtual bool next(cv::Mat &image);
+		virtual bool close();
+		
+		/**
+		 * Restarts streaming right away if the device is open, like
+		 * setWidth() and setHeight() do.
+		 */
+		void setPixelFormat(const PixelFormat pixelFormat);
+		PixelFormat pixelFormat() const;
+		
+		/**
+		 * The number of buffers queued in the driver. Fewer buffers mean
+		 * fresher frames, but the driver will drop frames if next() isn't
+		 * called often enough. Restarts streaming right away if the device
+		 * is open. Defaults to 2.
+		 */
+		void setBufferCount(const unsigned count);
+		unsigned bufferCount() const;
+		
+		/**
+		 * If enabled, next() dequeues every filled buffer and only converts
+		 * the newest one, so the returned frame is never older than one
+		 * capture interval. Enabled by default.
+		 */
+		void setDropStaleFrames(const bool drop);
+		bool dropStaleFrames() const;
+		
+	private:
+		struct Buffer
+		{
+			void *start;
+			size_t length;
+		};
+		
+		bool startStreaming();
+		void stopStreaming();
+		bool restart();
+		bool dequeue(unsigned &index, unsigned &bytesUsed);
+		bool enqueue(const unsigned index);
+		bool convert(const unsigned index, const unsigned bytesUsed, cv::Mat &image);
+		
+		int m_fd;
+		bool m_streaming;
+		PixelFormat m_pixelFormat;
+		unsigned m_bufferCount;
+		bool m_dropStale;
+		
+		unsigned m_width;
+		unsigned m_height;
+		unsigned m_bytesPerLine;
+		
+		std::vector<Buffer> m_buffers;
+	};
+}
+
+#endif
+
+#endif
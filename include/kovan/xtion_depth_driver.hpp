@@ -34,6 +34,8 @@
 namespace depth
 {
   class XtionDepthDriverImpl;
+  class DepthRecorder;
+  struct RgbdFrame;
   
   class EXPORT_SYM XtionDepthDriver : public DepthDriver
   {
@@ -76,6 +78,37 @@ namespace depth
       * \return DepthImage object
       */
     virtual DepthImage *depthImage() const;
+    
+    /**
+      * Writes every new frame returned by depthImage() to the recorder.
+      * The recorder is not owned.
+      *
+      * \param recorder An open recorder, or 0 to stop recording
+      */
+    void setRecorder(DepthRecorder *const recorder);
+    DepthRecorder *recorder() const;
+    
+    /**
+      * Filters frames on the OpenNI thread as they arrive, so readers
+      * never wait for it
+      */
+    virtual void setFilter(DepthFilter *const filter);
+    virtual DepthFilter *filter() const;
+    
+    /**
+      * Also streams color, with depth registered to it and synchronized
+      * with it in hardware. Takes effect right away if the driver is open;
+      * depth keeps streaming either way.
+      */
+    void setColorEnabled(const bool enabled);
+    bool colorEnabled() const;
+    
+    /**
+      * Takes the newest color and depth frames captured together
+      *
+      * \return false if color isn't streaming or no new pair is ready
+      */
+    bool rgbdFrame(RgbdFrame &frame);
 
     virtual ~XtionDepthDriver();
 
@@ -28,60 +28,25 @@
 #ifndef _XTION_DEPTH_IMAGE_HPP_
 #define _XTION_DEPTH_IMAGE_HPP_
 
-#include "depth_image.hpp"
+#include "sensor_depth_image.hpp"
 #include "geom.hpp"
 
 namespace depth
 {
   class XtionDepthDriverImpl;
   
-  class EXPORT_SYM XtionDepthImage : public DepthImage
+  class EXPORT_SYM XtionDepthImage : public SensorDepthImage
   {
   public:
     XtionDepthImage(const void *const data, const uint32_t size, const uint32_t width,
-      const uint32_t height, const uint16_t orientation, XtionDepthDriverImpl *const impl);
+      const uint32_t height, const uint16_t orientation, XtionDepthDriverImpl *const impl,
+      const uint32_t frameNumber = 0, const double timestamp = 0.0,
+      const float *const columnRays = 0, const float *const rowRays = 0);
     virtual ~XtionDepthImage();
-    /**
-     * Sets the depth camera orientation
-     *
-     * \param orientation Depth camera orientation (0 or 180 degree)
-     */
-    virtual void setOrientation(const uint16_t orientation);
-    
-    /**
-     * Gets the depth camera orientation
-     *
-     * \return Depth camera orientation (0 - 359 degree)
-     */
-    virtual uint16_t orientation() const;
-    
-    /**
-    * Returns the height of the depth image in pixel
-    *
-    * \return Height of the depth image in pixel
-    */
-    virtual uint32_t height() const;
-
-    /**
-    * Returns the width of the depth image in pixel
-    *
-    * \return Width of the depth image in pixel
-    */
-    virtual uint32_t width() const;
-
-    /**
-     * Returns the depth value of the specified point.
-     *
-     * \param row The row index of the point
-     * \param column The column index of the point
-     * \return The depth value
-     */
-    virtual uint16_t depthAt(const uint32_t row, const uint32_t column) const;
-    
-    virtual void depth(uint16_t *const data, const uint32_t offset, const uint32_t size) const;
 
     /**
-     * Returns the specified point.
+     * Returns the specified point. Falls back to OpenNI's coordinate
+     * converter when the image has no ray tables.
      *
      * \param row The row index of the point
      * \param column The column index of the point
@@ -90,13 +55,9 @@ namespace depth
     virtual Point3<int32_t> pointAt(const uint32_t row, const uint32_t column) const;
     
     const void *data() const;
-  
+    
   private:
-    const void *_data;
     uint32_t _size;
-    uint32_t _width;
-    uint32_t _height;
-    uint16_t _orientation;
     XtionDepthDriverImpl *_impl;
   };
 }
@@ -1,11 +1,15 @@
 #include "kovan/camera.hpp"
 #include "kovan/ardrone.hpp"
+#include "kovan/camera_profiler.hpp"
+#include "kovan/recorded_input_provider.hpp"
 #include "channel_p.hpp"
+#include "channel_worker_p.hpp"
 #include "camera_c_p.hpp"
 #include "warn.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <cassert>
 #include <opencv2/core/core.hpp>
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -23,10 +27,7 @@ Camera::Object::Object(const Point2<unsigned> &centroid,
 	m_data(0),
 	m_dataLength(dataLength)
 {
-	if(!data) return;
-	
-	m_data = new char[m_dataLength];
-	memcpy(m_data, data, m_dataLength);
+	setData(data, dataLength);
 }
 
 Camera::Object::Object(const Object &rhs)
@@ -36,16 +37,112 @@ Camera::Object::Object(const Object &rhs)
 	m_data(0),
 	m_dataLength(rhs.m_dataLength)
 {
-	if(!rhs.m_data) return;
+	setData(rhs.m_data, rhs.m_dataLength);
+}
+
+#if __cplusplus >= 201103L
+Camera::Object::Object(Object &&rhs)
+	: m_centroid(rhs.m_centroid),
+	m_boundingBox(rhs.m_boundingBox),
+	m_confidence(rhs.m_confidence),
+	m_data(0),
+	m_dataLength(rhs.m_dataLength)
+{
+	if(rhs.isInline()) {
+		setData(rhs.m_data, rhs.m_dataLength);
+		return;
+	}
 	
-	m_data = new char[m_dataLength + 1];
-	memcpy(m_data, rhs.m_data, m_dataLength);
-	m_data[m_dataLength] = 0;
+	m_data = rhs.m_data;
+	rhs.m_data = 0;
+	rhs.m_dataLength = 0;
 }
+#endif
 
 Camera::Object::~Object()
 {
-	delete[] m_data;
+	releaseData();
+}
+
+Camera::Object &Camera::Object::operator =(const Object &rhs)
+{
+	if(this == &rhs) return *this;
+	
+	m_centroid = rhs.m_centroid;
+	m_boundingBox = rhs.m_boundingBox;
+	m_confidence = rhs.m_confidence;
+	setData(rhs.m_data, rhs.m_dataLength);
+	return *this;
+}
+
+#if __cplusplus >= 201103L
+Camera::Object &Camera::Object::operator =(Object &&rhs)
+{
+	if(this == &rhs) return *this;
+	
+	m_centroid = rhs.m_centroid;
+	m_boundingBox = rhs.m_boundingBox;
+	m_confidence = rhs.m_confidence;
+	if(rhs.isInline()) {
+		setData(rhs.m_data, rhs.m_dataLength);
+		return *this;
+	}
+	
+	releaseData();
+	m_data = rhs.m_data;
+	m_dataLength = rhs.m_dataLength;
+	rhs.m_data = 0;
+	rhs.m_dataLength = 0;
+	return *this;
+}
+#endif
+
+void Camera::Object::swap(Object &rhs)
+{
+	if(this == &rhs) return;
+	
+	// Heap buffers can simply trade owners. Inline buffers have to be
+	// copied, since m_data points into the object itself.
+	if(!isInline() && !rhs.isInline()) {
+		std::swap(m_centroid, rhs.m_centroid);
+		std::swap(m_boundingBox, rhs.m_boundingBox);
+		std::swap(m_confidence, rhs.m_confidence);
+		std::swap(m_data, rhs.m_data);
+		std::swap(m_dataLength, rhs.m_dataLength);
+		return;
+	}
+	
+	Object tmp(*this);
+	*this = rhs;
+	rhs = tmp;
+}
+
+void Camera::Object::setData(const char *data, const size_t &dataLength)
+{
+	if(data && m_data == data) return;
+	
+	char *const old = isInline() ? 0 : m_data;
+	
+	m_data = 0;
+	m_dataLength = dataLength;
+	if(data) {
+		m_data = dataLength < InlineDataSize ? m_inlineData : new char[dataLength + 1];
+		memmove(m_data, data, dataLength);
+		m_data[dataLength] = 0;
+	}
+	
+	delete[] old;
+}
+
+void Camera::Object::releaseData()
+{
+	if(!isInline()) delete[] m_data;
+	m_data = 0;
+}
+
+bool Camera::Object::isInline() const
+{
+	return m_data == m_inlineData;
 }
 
 const Point2<unsigned> &Camera::Object::centroid() const
@@ -73,8 +170,248 @@ const size_t Camera::Object::dataLength() const
 	return m_dataLength;
 }
 
+// FrameCache //
+
+Camera::FrameCache::Entry::Entry()
+	: valid(false)
+{
+}
+
+Camera::ColorTable::ColorTable()
+{
+}
+
+void Camera::ColorTable::clear()
+{
+	m_ranges.clear();
+	m_table.clear();
+}
+
+int Camera::ColorTable::add(const cv::Vec3b &bottom, const cv::Vec3b &top)
+{
+	const int existing = bit(bottom, top);
+	if(existing >= 0) return existing;
+	if(m_ranges.size() >= MaxRanges) return -1;
+	
+	if(m_table.empty()) m_table.resize(Size, 0);
+	
+	// Classify the center of every quantized cell
+	cv::Mat cells(1, Size, CV_8UC3);
+	cv::Vec3b *const cell = cells.ptr<cv::Vec3b>();
+	const unsigned shift = 8 - Bits;
+	const unsigned mask = (1 << Bits) - 1;
+	const unsigned center = 1 << (shift - 1);
+	for(unsigned i = 0; i < Size; ++i) {
+		cell[i][0] = ((i >> (2 * Bits)) << shift) | center;
+		cell[i][1] = (((i >> Bits) & mask) << shift) | center;
+		cell[i][2] = ((i & mask) << shift) | center;
+	}
+	
+	cv::Mat hsv;
+#if CV_VERSION_EPOCH == 3
+	cv::cvtColor(cells, hsv, cv::COLOR_BGR2HSV);
+#else
+	cv::cvtColor(cells, hsv, CV_BGR2HSV);
+#endif
+	
+	const int ret = m_ranges.size();
+	const unsigned int flag = 1U << ret;
+	const bool wraps = bottom[0] > top[0];
+	const cv::Vec3b *const color = hsv.ptr<cv::Vec3b>();
+	for(unsigned i = 0; i < Size; ++i) {
+		const cv::Vec3b &c = color[i];
+		if(c[1] < bottom[1] || c[1] > top[1] || c[2] < bottom[2] || c[2] > top[2]) continue;
+		if(wraps ? (c[0] < bottom[0] && c[0] > top[0]) : (c[0] < bottom[0] || c[0] > top[0])) continue;
+		m_table[i] |= flag;
+	}
+	
+	m_ranges.push_back(key(bottom, top));
+	return ret;
+}
+
+int Camera::ColorTable::bit(const cv::Vec3b &bottom, const cv::Vec3b &top) const
+{
+	const std::vector<unsigned long long>::const_iterator it
+		= std::find(m_ranges.begin(), m_ranges.end(), key(bottom, top));
+	return it == m_ranges.end() ? -1 : it - m_ranges.begin();
+}
+
+bool Camera::ColorTable::isEmpty() const
+{
+	return m_ranges.empty();
+}
+
+void Camera::ColorTable::classify(const cv::Mat &bgr, cv::Mat &labels) const
+{
+	labels.create(bgr.rows, bgr.cols, CV_32SC1);
+	if(m_table.empty()) {
+		labels.setTo(cv::Scalar(0));
+		return;
+	}
+	
+	const unsigned int *const table = &m_table[0];
+	const unsigned shift = 8 - Bits;
+	for(int y = 0; y < bgr.rows; ++y) {
+		const uchar *src = bgr.ptr<uchar>(y);
+		unsigned int *const dst = labels.ptr<unsigned int>(y);
+		for(int x = 0; x < bgr.cols; ++x, src += 3) {
+			dst[x] = table[(src[0] >> shift) << (2 * Bits)
+				| (src[1] >> shift) << Bits | src[2] >> shift];
+		}
+	}
+}
+
+void Camera::ColorTable::classify(const cv::Mat &bgr, const int bit, cv::Mat &mask) const
+{
+	mask.create(bgr.rows, bgr.cols, CV_8UC1);
+	if(m_table.empty() || bit < 0 || bit >= (int)m_ranges.size()) {
+		mask.setTo(cv::Scalar(0));
+		return;
+	}
+	
+	const unsigned int *const table = &m_table[0];
+	const unsigned int flag = 1U << bit;
+	const unsigned shift = 8 - Bits;
+	for(int y = 0; y < bgr.rows; ++y) {
+		const uchar *src = bgr.ptr<uchar>(y);
+		uchar *const dst = mask.ptr<uchar>(y);
+		for(int x = 0; x < bgr.cols; ++x, src += 3) {
+			dst[x] = (table[(src[0] >> shift) << (2 * Bits)
+				| (src[1] >> shift) << Bits | src[2] >> shift] & flag) ? 255 : 0;
+		}
+	}
+}
+
+unsigned long long Camera::ColorTable::key(const cv::Vec3b &bottom, const cv::Vec3b &top)
+{
+	return (unsigned long long)bottom[0] << 40 | (unsigned long long)bottom[1] << 32
+		| (unsigned long long)bottom[2] << 24 | top[0] << 16 | top[1] << 8 | top[2];
+}
+
+Camera::FrameCache::FrameCache()
+	: m_frameNumber(0),
+	m_colorTable(0)
+{
+}
+
+Camera::FrameCache::~FrameCache()
+{
+	std::map<int, Entry *>::const_iterator it = m_conversions.begin();
+	for(; it != m_conversions.end(); ++it) delete it->second;
+	for(it = m_levels.begin(); it != m_levels.end(); ++it) delete it->second;
+}
+
+void Camera::FrameCache::setImage(const cv::Mat &image, const unsigned long frameNumber)
+{
+	m_mutex.lock();
+	m_image = image;
+	m_frameNumber = frameNumber;
+	std::map<int, Entry *>::const_iterator it = m_conversions.begin();
+	for(; it != m_conversions.end(); ++it) it->second->valid = false;
+	for(it = m_levels.begin(); it != m_levels.end(); ++it) it->second->valid = false;
+	m_labels.valid = false;
+	m_mutex.unlock();
+}
+
+const cv::Mat &Camera::FrameCache::image() const
+{
+	return m_image;
+}
+
+unsigned long Camera::FrameCache::frameNumber() const
+{
+	return m_frameNumber;
+}
+
+bool Camera::FrameCache::isFrame(const cv::Mat &image) const
+{
+	return !image.empty() && image.data == m_image.data
+		&& image.cols == m_image.cols && image.rows == m_image.rows
+		&& image.step == m_image.step;
+}
+
+const cv::Mat &Camera::FrameCache::converted(const int code)
+{
+	Entry *const e = entry(m_conversions, code);
+	e->mutex.lock();
+	if(!e->valid) {
+		if(m_image.empty()) e->image = cv::Mat();
+		else {
+			Profiler::Scope scope(Profiler::Conversion);
+			cv::cvtColor(m_image, e->image, code);
+		}
+		e->valid = true;
+	}
+	e->mutex.unlock();
+	return e->image;
+}
+
+void Camera::FrameCache::setColorTable(const ColorTable *const colorTable)
+{
+	m_colorTable = colorTable;
+	m_labels.valid = false;
+}
+
+const Camera::ColorTable *Camera::FrameCache::colorTable() const
+{
+	return m_colorTable;
+}
+
+const cv::Mat &Camera::FrameCache::labels()
+{
+	m_labels.mutex.lock();
+	if(!m_labels.valid) {
+		if(m_image.empty() || !m_colorTable) m_labels.image = cv::Mat();
+		else {
+			Profiler::Scope scope(Profiler::Threshold);
+			m_colorTable->classify(m_image, m_labels.image);
+		}
+		m_labels.valid = true;
+	}
+	m_labels.mutex.unlock();
+	return m_labels.image;
+}
+
+const cv::Mat &Camera::FrameCache::level(const unsigned level)
+{
+	if(!level) return m_image;
+	
+	const cv::Mat &previous = this->level(level - 1);
+	Entry *const e = entry(m_levels, level);
+	e->mutex.lock();
+	if(!e->valid) {
+		if(previous.empty()) e->image = cv::Mat();
+		else {
+			const cv::Size size(std::max(previous.cols / 2, 1), std::max(previous.rows / 2, 1));
+#if CV_VERSION_EPOCH == 3
+			cv::resize(previous, e->image, size, 0, 0, cv::INTER_AREA);
+#else
+			cv::resize(previous, e->image, size, 0, 0, CV_INTER_AREA);
+#endif
+		}
+		e->valid = true;
+	}
+	e->mutex.unlock();
+	return e->image;
+}
+
+Camera::FrameCache::Entry *Camera::FrameCache::entry(std::map<int, Entry *> &entries,
+	const int key)
+{
+	m_mutex.lock();
+	Entry *&ret = entries[key];
+	if(!ret) ret = new Entry;
+	m_mutex.unlock();
+	return ret;
+}
+
+// ChannelImpl //
+
 ChannelImpl::ChannelImpl()
-	: m_dirty(true)
+	: m_dirty(true),
+	m_findingObjects(false),
+	m_frameCache(0),
+	m_decimation(1)
 {
 }
 
@@ -93,19 +430,123 @@ void ChannelImpl::setImage(const cv::Mat &image)
 	m_dirty = true;
 }
 
+void ChannelImpl::setFrameCache(FrameCache *const frameCache)
+{
+	m_frameCache = frameCache;
+}
+
+FrameCache *ChannelImpl::frameCache() const
+{
+	return m_frameCache;
+}
+
 ObjectVector ChannelImpl::objects(const Config &config)
 {
-	if(m_dirty) {
-		update(m_image);
+	ObjectVector ret;
+	objects(config, ret);
+	return ret;
+}
+
+void ChannelImpl::objects(const Config &config, ObjectVector &objects)
+{
+	this->objects(config, objects, cv::Rect());
+}
+
+static Camera::Object mapToFrame(const Camera::Object &object, const cv::Rect &window,
+	const unsigned decimation)
+{
+	const Point2<unsigned> &c = object.centroid();
+	const Rect<unsigned> &b = object.boundingBox();
+	return Camera::Object(Point2<unsigned>(c.x() * decimation + window.x, c.y() * decimation + window.y),
+		Rect<unsigned>(b.x() * decimation + window.x, b.y() * decimation + window.y,
+			b.width() * decimation, b.height() * decimation),
+		object.confidence(), object.data(), object.dataLength());
+}
+
+void ChannelImpl::objects(const Config &config, ObjectVector &objects,
+	const cv::Rect &roi, const unsigned decimation)
+{
+	const cv::Rect frame(0, 0, m_image.cols, m_image.rows);
+	cv::Rect window = (roi.width > 0 && roi.height > 0) ? roi & frame : frame;
+	const unsigned dec = decimation ? decimation : 1;
+	
+	// Align decimated windows to whole pixels of the smaller image
+	if(dec > 1) {
+		const int x = window.x / (int)dec * (int)dec;
+		const int y = window.y / (int)dec * (int)dec;
+		window = cv::Rect(x, y, window.width + window.x - x, window.height + window.y - y);
+	}
+	
+	if(m_dirty || window != m_window || dec != m_decimation) {
+		if(m_image.empty() || window.area() <= 0) update(cv::Mat());
+		else if(window == frame && dec == 1) update(m_image);
+		else if(dec == 1) update(m_image(window));
+		else if(m_frameCache && m_frameCache->isFrame(m_image)) {
+			// Take the window out of the frame's shared pyramid level
+			const cv::Mat &level = m_frameCache->level(dec == 4 ? 2 : 1);
+			const cv::Rect scaled = cv::Rect(window.x / dec, window.y / dec,
+				std::max(window.width / (int)dec, 1), std::max(window.height / (int)dec, 1))
+				& cv::Rect(0, 0, level.cols, level.rows);
+			if(scaled.area() <= 0) update(cv::Mat());
+			else update(level(scaled));
+		} else {
+			const cv::Size size(std::max(window.width / (int)dec, 1),
+				std::max(window.height / (int)dec, 1));
+#if CV_VERSION_EPOCH == 3
+			cv::resize(m_image(window), m_decimated, size, 0, 0, cv::INTER_NEAREST);
+#else
+			cv::resize(m_image(window), m_decimated, size, 0, 0, CV_INTER_NEAREST);
+#endif
+			update(m_decimated);
+		}
+		m_window = window;
+		m_decimation = dec;
 		m_dirty = false;
 	}
-	return findObjects(config);
+	
+	objects.clear();
+	findObjects(config, objects);
+	
+	if(m_window.x == 0 && m_window.y == 0 && m_decimation == 1) return;
+	ObjectVector::iterator it = objects.begin();
+	for(; it != objects.end(); ++it) *it = mapToFrame(*it, m_window, m_decimation);
+}
+
+ObjectVector ChannelImpl::findObjects(const Config &config)
+{
+	// Ending up here again means neither overload is overridden
+	assert(!m_findingObjects);
+#ifndef NDEBUG
+	m_findingObjects = true;
+#endif
+	ObjectVector ret;
+	findObjects(config, ret);
+#ifndef NDEBUG
+	m_findingObjects = false;
+#endif
+	return ret;
+}
+
+void ChannelImpl::findObjects(const Config &config, ObjectVector &objects)
+{
+	assert(!m_findingObjects);
+#ifndef NDEBUG
+	m_findingObjects = true;
+#endif
+	objects = findObjects(config);
+#ifndef NDEBUG
+	m_findingObjects = false;
+#endif
 }
 
 ChannelImplManager::~ChannelImplManager()
 {
 }
 
+void ChannelImplManager::setFrameCache(FrameCache *const frameCache)
+{
+}
+
 DefaultChannelImplManager::DefaultChannelImplManager()
 {
 	m_channelImpls["hsv"] = new Private::Camera::HsvChannelImpl();
@@ -124,6 +565,12 @@ void DefaultChannelImplManager::setImage(const cv::Mat &image)
 	for(; it != m_channelImpls.end(); ++it) it->second->setImage(image);
 }
 
+void DefaultChannelImplManager::setFrameCache(FrameCache *const frameCache)
+{
+	std::map<std::string, ChannelImpl *>::iterator it = m_channelImpls.begin();
+	for(; it != m_channelImpls.end(); ++it) it->second->setFrameCache(frameCache);
+}
+
 ChannelImpl *DefaultChannelImplManager::channelImpl(const std::string &name)
 {
 	std::map<std::string, ChannelImpl *>::iterator it = m_channelImpls.find(name);
@@ -134,9 +581,14 @@ Camera::Channel::Channel(Device *device, const Config &config)
 	: m_device(device),
 	m_config(config),
 	m_impl(0),
-	m_valid(false)
+	m_valid(false),
+	m_decimation(1),
+	m_follow(false),
+	m_lastQueried(device->frameNumber()),
+	m_starved(false)
 {
 	m_objects.clear();
+	readConfig();
 	const std::string type = config.stringValue("type");
 	if(type.empty()) {
 		WARN("No type specified in config.");
@@ -170,12 +622,47 @@ public:
 } LargestAreaFirst;
 
 const ObjectVector *Camera::Channel::objects() const
+{
+	m_lastQueried = m_device->frameNumber();
+	return evaluate();
+}
+
+const ObjectVector *Camera::Channel::evaluate() const
 {
 	if(!m_impl) return 0;
 	if(!m_valid) {
-		m_objects.clear();
-		m_objects = m_impl->objects(m_config);
-		std::sort(m_objects.begin(), m_objects.end(), LargestAreaFirst);
+		// The impl was idle and didn't receive this frame yet
+		if(m_starved) m_device->feed(m_impl);
+		
+		// m_objects keeps its capacity between frames
+		const bool hinted = m_searchWindow.area() > 0;
+		m_impl->objects(m_config, m_objects, hinted ? m_searchWindow : m_roi, m_decimation);
+		
+		// Nothing inside of the hinted window. Fall back to the whole ROI.
+		if(hinted && m_objects.empty()) {
+			m_impl->objects(m_config, m_objects, m_roi, m_decimation);
+		}
+		
+		{
+			Profiler::Scope scope(Profiler::Sort);
+			std::sort(m_objects.begin(), m_objects.end(), LargestAreaFirst);
+		}
+		
+		m_searchWindow = cv::Rect();
+		if(m_follow) {
+			if(!m_objects.empty()) {
+				// Search a window three times the size of the largest blob
+				// next frame
+				const Rect<unsigned> &b = m_objects[0].boundingBox();
+				const int x = b.x();
+				const int y = b.y();
+				const int w = b.width();
+				const int h = b.height();
+				m_searchWindow = cv::Rect(x - w, y - h, w * 3, h * 3);
+				if(m_roi.area() > 0) m_searchWindow &= m_roi;
+			}
+		}
+		
 		m_valid = true;
 	}
 	return &m_objects;
@@ -186,12 +673,56 @@ Device *Camera::Channel::device() const
 	return m_device;
 }
 
+ChannelImpl *Camera::Channel::channelImpl() const
+{
+	return m_impl;
+}
+
 void Camera::Channel::setConfig(const Config &config)
 {
 	m_config = config;
+	readConfig();
 	invalidate();
 }
 
+const cv::Rect &Camera::Channel::regionOfInterest() const
+{
+	return m_roi;
+}
+
+unsigned Camera::Channel::decimation() const
+{
+	return m_decimation;
+}
+
+void Camera::Channel::setSearchWindow(const cv::Rect &window)
+{
+	m_searchWindow = window;
+	if(m_roi.area() > 0) m_searchWindow &= m_roi;
+}
+
+bool Camera::Channel::isInDemand() const
+{
+	const unsigned window = m_device->demandWindow();
+	return !window || m_device->frameNumber() - m_lastQueried <= window;
+}
+
+void Camera::Channel::readConfig()
+{
+	m_roi = cv::Rect(std::max(m_config.intValue(CAMERA_CHANNEL_ROI_X_KEY), 0),
+		std::max(m_config.intValue(CAMERA_CHANNEL_ROI_Y_KEY), 0),
+		std::max(m_config.intValue(CAMERA_CHANNEL_ROI_WIDTH_KEY), 0),
+		std::max(m_config.intValue(CAMERA_CHANNEL_ROI_HEIGHT_KEY), 0));
+	
+	m_decimation = 1;
+	const int decimation = m_config.intValue(CAMERA_CHANNEL_DECIMATION_KEY);
+	if(decimation == 2 || decimation == 4) m_decimation = decimation;
+	else if(decimation > 1) WARN("Unsupported decimation %d, ignoring", decimation);
+	
+	m_follow = m_config.boolValue(CAMERA_CHANNEL_ROI_FOLLOW_KEY);
+	m_searchWindow = cv::Rect();
+}
+
 // ConfigPath //
 
 std::string Camera::ConfigPath::s_path = "/etc/botui/channels/";
@@ -246,6 +777,11 @@ InputProvider::~InputProvider()
 {
 }
 
+bool InputProvider::worldPoint(const Rect<unsigned> &window, Point3<int32_t> &point) const
+{
+	return false;
+}
+
 UsbInputProvider::UsbInputProvider()
 	: m_capture(new cv::VideoCapture)
 {
@@ -305,15 +841,30 @@ bool UsbInputProvider::close()
 
 using namespace depth;
 
+// Depths (in mm) at or beyond this are colored black
+#define DEPTH_COLOR_TABLE_SIZE 8192
+
 static bool s_lookupTableInited = false;
-static QColor s_lookupTable[350];
 
-DepthInputProvider::DepthInputProvider(){
+// Packed BGR per depth in mm: blue in the lowest byte
+static uint32_t s_lookupTable[DEPTH_COLOR_TABLE_SIZE];
+
+DepthInputProvider::DepthInputProvider()
+	: m_width(160),
+	m_height(120),
+	m_groundRemoval(false),
+	m_depthWidth(0)
+{
 	if(!s_lookupTableInited){
-		for(unsigned short i = 0; i < 330; i++){
-			s_lookupTable[i] = QColor::fromHsv(i, 255, 255);
+		for(int32_t depth = 0; depth < DEPTH_COLOR_TABLE_SIZE; ++depth) {
+			const int32_t hue = qMax(qMin(330, ((depth - 500) * 330) >> 12), 0);
+			if(hue == 0 || hue == 330) {
+				s_lookupTable[depth] = 0;
+				continue;
+			}
+			const QColor color = QColor::fromHsv(hue, 255, 255);
+			s_lookupTable[depth] = color.blue() | color.red() << 8 | color.green() << 16;
 		}
-		s_lookupTable[0] = QColor::fromRgb(0, 0, 0);
 		s_lookupTableInited = true;
 	}
 }
@@ -334,9 +885,11 @@ bool DepthInputProvider::isOpen() const{
 }
 
 void DepthInputProvider::setWidth(const unsigned width){
+	m_width = width;
 }
 
 void DepthInputProvider::setHeight(const unsigned height){
+	m_height = height;
 }
 
 bool DepthInputProvider::next(cv::Mat &image){
@@ -351,33 +904,62 @@ bool DepthInputProvider::next(cv::Mat &image){
 	}
 	else{	
 		DepthImage* depthImage = DepthDriver::instance().depthImage();
-		//cv::Mat img(240, 320, CV_8UC3);
-		cv::Mat img(120, 160, CV_8UC3);
-		//image.create(240, 320, CV_8UC3);
-		image.create(120, 160, CV_8UC3);
-		for(int row = 0; row < img.rows; ++row) {
-			cv::Vec3b* p = img.ptr<cv::Vec3b>(row);
-			for(int col = 0; col < img.cols; ++col) {
-				int32_t depth = (int32_t)depthImage->depthAt(row * 2, col * 2) - 500;
-				int32_t hsv = qMax(qMin(330, (depth * 330) >> 12), 0);
-				p[col][0] = s_lookupTable[hsv].blue();
-				p[col][1] = s_lookupTable[hsv].red();
-				p[col][2] = s_lookupTable[hsv].green();
+		if(!depthImage || !m_width || !m_height) return false;
+		
+		const uint32_t depthWidth = depthImage->width();
+		const uint32_t depthHeight = depthImage->height();
+		
+		// Source column of every output column
+		if(m_columns.size() != m_width || m_depthWidth != depthWidth) {
+			m_columns.resize(m_width);
+			for(unsigned col = 0; col < m_width; ++col) m_columns[col] = col * depthWidth / m_width;
+			m_depthWidth = depthWidth;
+		}
+		m_row.resize(depthWidth);
+		
+		const bool removeGround = m_groundRemoval && m_groundPlane.update(*depthImage);
+		if(removeGround) m_ground.resize(depthWidth);
+		
+		image.create(m_height, m_width, CV_8UC3);
+		const uint32_t *const columns = &m_columns[0];
+		uint16_t *const row = &m_row[0];
+		for(unsigned y = 0; y < m_height; ++y) {
+			const uint32_t depthRow = y * depthHeight / m_height;
+			depthImage->row(depthRow, row);
+			if(removeGround) {
+				m_groundPlane.mask(*depthImage, &m_ground[0], depthRow, 1);
+				for(uint32_t col = 0; col < depthWidth; ++col) if(m_ground[col]) row[col] = 0;
+			}
+			
+			uchar *p = image.ptr<uchar>(y);
+			for(unsigned col = 0; col < m_width; ++col, p += 3) {
+				const uint16_t depth = row[columns[col]];
+				const uint32_t bgr = s_lookupTable[depth < DEPTH_COLOR_TABLE_SIZE ? depth : DEPTH_COLOR_TABLE_SIZE - 1];
+				p[0] = bgr;
+				p[1] = bgr >> 8;
+				p[2] = bgr >> 16;
 			}
 		}
-		/*cv::MatIterator_<cv::Vec3b> it, end;
-            	for( it = image.begin<cv::Vec3b>(), end = image.end<cv::Vec3b>(); it != end; ++it)
-            	{
-                	(*it)[0] = 200;
-                	(*it)[1] = 20;
-                	(*it)[2] = 100;
-            	}*/
-		image = img.clone();
-	//
 	}
 	return true;
 }
 
+void DepthInputProvider::setGroundRemoval(const bool groundRemoval)
+{
+	m_groundRemoval = groundRemoval;
+	m_groundPlane.reset();
+}
+
+bool DepthInputProvider::groundRemoval() const
+{
+	return m_groundRemoval;
+}
+
+depth::GroundPlane *DepthInputProvider::groundPlane()
+{
+	return &m_groundPlane;
+}
+
 bool DepthInputProvider::close(){
 	DepthDriver::instance().close();
 	return ! DepthDriver::instance().isOpen();
@@ -390,8 +972,14 @@ bool DepthInputProvider::close(){
 	m_channelImplManager(new DefaultChannelImplManager),
 	m_bgr(0),
 	m_image(320, 240, CV_8UC3),
-	m_bgrSize(0)
+	m_bgrSize(0),
+	m_parallel(false),
+	m_workers(0),
+	m_demandWindow(0),
+	m_frameNumber(0),
+	m_recorder(0)
 {
+	m_channelImplManager->setFrameCache(&m_frameCache);
 	Config *config = Config::load(Camera::ConfigPath::defaultConfigPath());
 	if(!config) return;
 	setConfig(*config);
@@ -403,7 +991,8 @@ Camera::Device::~Device()
 	ChannelPtrVector::const_iterator it = m_channels.begin();
 	for(; it != m_channels.end(); ++it) delete *it;
 	delete m_inputProvider;
-	delete m_bgr;
+	delete[] m_bgr;
+	delete m_workers;
 }
 
 bool Camera::Device::open(const int number)
@@ -447,20 +1036,53 @@ bool Camera::Device::close()
 bool Camera::Device::update()
 {
 	// Get new image
-	if(!m_inputProvider->next(m_image)) {
+	bool captured;
+	{
+		Profiler::Scope scope(Profiler::Capture);
+		captured = m_inputProvider->next(m_image);
+	}
+	if(!captured) {
 		m_image = cv::Mat();
+		m_frameCache.setImage(m_image, m_frameNumber);
 		return false;
 	}
 	
+	++m_frameNumber;
+	if(m_recorder) m_recorder->write(m_image);
+	m_frameCache.setImage(m_image, m_frameNumber);
+	
 	// No need to update channels if there are none.
 	if(m_channels.empty()) return true;
 	
-	// Dirty all channel impls
-	m_channelImplManager->setImage(m_image);
+	if(!m_demandWindow) {
+		// Dirty all channel impls
+		m_channelImplManager->setImage(m_image);
+	} else {
+		// Only give the frame to impls that have a channel in demand
+		std::map<ChannelImpl *, bool> demand;
+		ChannelPtrVector::const_iterator it = m_channels.begin();
+		for(; it != m_channels.end(); ++it) {
+			if(!(*it)->m_impl) continue;
+			bool &inDemand = demand[(*it)->m_impl];
+			inDemand = inDemand || (*it)->isInDemand();
+		}
+		
+		std::map<ChannelImpl *, bool>::const_iterator dit = demand.begin();
+		for(; dit != demand.end(); ++dit) dit->first->setImage(dit->second ? m_image : cv::Mat());
+		
+		for(it = m_channels.begin(); it != m_channels.end(); ++it) {
+			(*it)->m_starved = (*it)->m_impl && !demand[(*it)->m_impl];
+		}
+	}
 	
 	// Invalidate all channels
 	ChannelPtrVector::const_iterator it = m_channels.begin();
 	for(; it != m_channels.end(); ++it) (*it)->invalidate();
+	
+	if(m_parallel) {
+		if(!m_workers) m_workers = new Private::ChannelWorkerPool;
+		m_workers->evaluate(m_channels);
+	}
 	return true;
 }
 
@@ -479,6 +1101,11 @@ const cv::Mat &Camera::Device::rawImage() const
 	return m_image;
 }
 
+FrameCache *Camera::Device::frameCache()
+{
+	return &m_frameCache;
+}
+
 void Camera::Device::setConfig(const Config &config)
 {
 	m_config = config;
@@ -494,6 +1121,7 @@ void Camera::Device::setChannelImplManager(ChannelImplManager *channelImplManage
 {
 	delete m_channelImplManager;
 	m_channelImplManager = channelImplManager;
+	if(m_channelImplManager) m_channelImplManager->setFrameCache(&m_frameCache);
 }
 
 ChannelImplManager *Camera::Device::channelImplManager() const
@@ -503,27 +1131,100 @@ ChannelImplManager *Camera::Device::channelImplManager() const
 
 const unsigned char *Camera::Device::bgr() const
 {
-	const unsigned correctSize = m_image.rows * m_image.cols * m_image.elemSize();
+	if(m_image.isContinuous()) return m_image.data;
+	
+	const unsigned rowSize = m_image.cols * m_image.elemSize();
+	const unsigned correctSize = m_image.rows * rowSize;
 	if(m_bgrSize != correctSize) {
-		delete m_bgr;
+		delete[] m_bgr;
 		m_bgrSize = correctSize;
 		m_bgr = new unsigned char[m_bgrSize];
 	}
 	
-	for(unsigned row = 0; row < m_image.rows; ++row) {
-		unsigned offset1 = row * m_image.cols * m_image.elemSize();
-		memcpy(m_bgr + offset1, m_image.ptr(row), m_image.cols * m_image.elemSize());
+	for(int row = 0; row < m_image.rows; ++row) {
+		memcpy(m_bgr + row * rowSize, m_image.ptr(row), rowSize);
 	}
 	
 	return m_bgr;
 }
 
+const unsigned char *Camera::Device::bgr(unsigned &stride) const
+{
+	stride = m_image.step;
+	return m_image.data;
+}
+
+void Camera::Device::setParallelChannels(const bool parallel)
+{
+	m_parallel = parallel;
+}
+
+bool Camera::Device::parallelChannels() const
+{
+	return m_parallel;
+}
+
+void Camera::Device::setDemandWindow(const unsigned frames)
+{
+	m_demandWindow = frames;
+	
+	// Starved impls would never be fed again with demand tracking disabled
+	if(m_demandWindow) return;
+	ChannelPtrVector::const_iterator it = m_channels.begin();
+	for(; it != m_channels.end(); ++it) {
+		if((*it)->m_starved) feed((*it)->m_impl);
+	}
+}
+
+unsigned Camera::Device::demandWindow() const
+{
+	return m_demandWindow;
+}
+
+unsigned long Camera::Device::frameNumber() const
+{
+	return m_frameNumber;
+}
+
+void Camera::Device::setRecorder(FrameRecorder *const recorder)
+{
+	m_recorder = recorder;
+}
+
+Camera::FrameRecorder *Camera::Device::recorder() const
+{
+	return m_recorder;
+}
+
+bool Camera::Device::worldCentroid(const Object &object, Point3<int32_t> &point) const
+{
+	const Point2<unsigned> &centroid = object.centroid();
+	const Rect<unsigned> &box = object.boundingBox();
+	const unsigned width = std::max(box.width() / 2, 1U);
+	const unsigned height = std::max(box.height() / 2, 1U);
+	const unsigned x = centroid.x() > width / 2 ? centroid.x() - width / 2 : 0;
+	const unsigned y = centroid.y() > height / 2 ? centroid.y() - height / 2 : 0;
+	return m_inputProvider->worldPoint(Rect<unsigned>(x, y, width, height), point);
+}
+
+void Camera::Device::feed(ChannelImpl *const impl)
+{
+	impl->setImage(m_image);
+	ChannelPtrVector::const_iterator it = m_channels.begin();
+	for(; it != m_channels.end(); ++it) {
+		if((*it)->m_impl == impl) (*it)->m_starved = false;
+	}
+}
+
 void Camera::Device::updateConfig()
 {
 	ChannelPtrVector::const_iterator it = m_channels.begin();
 	for(; it != m_channels.end(); ++it) delete *it;
 	m_channels.clear();
 	
+	m_colorTable.clear();
+	m_frameCache.setColorTable(&m_colorTable);
+	
 	m_config.clearGroup();
 	m_config.beginGroup(CAMERA_GROUP);
 	int numChannels = m_config.intValue(CAMERA_NUM_CHANNELS_KEY);
@@ -534,6 +1235,19 @@ void Camera::Device::updateConfig()
 		stream << i;
 		m_config.beginGroup(stream.str());
 		m_channels.push_back(new Channel(this, m_config));
+		
+		// Channels using a lookup table share a bit in the color table
+		if(m_config.stringValue(CAMERA_CHANNEL_TYPE_KEY) == CAMERA_CHANNEL_TYPE_HSV_KEY
+			&& m_config.boolValue(CAMERA_CHANNEL_LUT_KEY)) {
+			const cv::Vec3b bottom(m_config.intValue("bh"),
+				m_config.intValue("bs"), m_config.intValue("bv"));
+			const cv::Vec3b top(m_config.intValue("th"),
+				m_config.intValue("ts"), m_config.intValue("tv"));
+			if(m_colorTable.add(bottom, top) < 0) {
+				WARN("color table is full, channel %d uses its own table", i);
+			}
+		}
+		
 		m_config.endGroup();
 	}
 	m_config.endGroup();
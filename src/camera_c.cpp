@@ -1,10 +1,12 @@
 #include "kovan/camera.h"
 #include "kovan/camera.hpp"
+#include "kovan/rgbd_input_provider.hpp"
 #include "nyi.h"
 #include "camera_c_p.hpp"
 
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
 
 using namespace Private;
 
@@ -59,16 +61,25 @@ int camera_open_device(int number, enum Resolution res)
 		width = 640;
 		height = 480;
 		break;
+	default: break;
 	}
-	DeviceSingleton::instance()->setWidth(width);
-	DeviceSingleton::instance()->setHeight(height);
+	if(width) DeviceSingleton::instance()->setWidth(width);
+	if(height) DeviceSingleton::instance()->setHeight(height);
 	return 1;
 }
 
+int camera_open_rgbd(enum Resolution res)
+{
+	DeviceSingleton::setInputProvider(new Camera::RgbdInputProvider);
+	return camera_open_device(0, res);
+}
+
 int camera_load_config(const char *name)
 {
 	Config *config = Config::load(Camera::ConfigPath::path(name));
 	if(!config) return 0;
+	DeviceSingleton::objectTable()->invalidate();
+	DeviceSingleton::trackerTable()->clear();
 	DeviceSingleton::instance()->setConfig(*config);
 	delete config;
 	return 1;
@@ -104,7 +115,10 @@ int get_camera_height(void)
 
 int camera_update(void)
 {
-	return DeviceSingleton::instance()->update() ? 1 : 0;
+	DeviceSingleton::objectTable()->invalidate();
+	if(!DeviceSingleton::instance()->update()) return 0;
+	DeviceSingleton::trackerTable()->update();
+	return 1;
 }
 
 pixel get_camera_pixel(point2 p)
@@ -145,42 +159,53 @@ bool check_channel(int i)
 	return true;
 }
 
-bool check_channel_and_object(int i, int j)
+static const ChannelObjects *channel_objects(int i)
 {
+	const ChannelObjects *const ret = DeviceSingleton::objectTable()->channel(i);
+	if(ret) return ret;
+	
 	const Camera::ChannelPtrVector &channels = DeviceSingleton::instance()->channels();
-	if(i < 0 || i >= channels.size()) {
-		if(!channels.size()) std::cout << "Active configuration doesn't have any channels.";
-		else std::cout << "Channel must be in the range 0 .. " << (channels.size() - 1);
-		std::cout << std::endl;
-		return false;
-	}
-	const Camera::ObjectVector *objs = channels[i]->objects();
-	if(j < 0 || j >= objs->size()) {
+	if(!channels.size()) std::cout << "Active configuration doesn't have any channels.";
+	else std::cout << "Channel must be in the range 0 .. " << (channels.size() - 1);
+	std::cout << std::endl;
+	return 0;
+}
+
+static const ChannelObjects *channel_objects(int i, int j)
+{
+	const ChannelObjects *const ret = channel_objects(i);
+	if(!ret) return 0;
+	if(j < 0 || j >= (int)ret->count) {
 		std::cout << "No such object " << j << std::endl;
-		return false;
+		return 0;
 	}
-	return true;
+	return ret;
+}
+
+bool check_channel_and_object(int i, int j)
+{
+	return channel_objects(i, j) != 0;
 }
 
 int get_object_count(int channel)
 {
 	if(!check_channel(channel)) return -1;
-	return DeviceSingleton::instance()->channels()[channel]->objects()->size();
+	return DeviceSingleton::objectTable()->channel(channel)->count;
 }
 
 double get_object_confidence(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return 0.0;
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.confidence();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return 0.0;
+	return o->confidence[object];
 }
 
 
 const char *get_object_data(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return 0;
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.data();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return 0;
+	return (*o->objects)[object].data();
 }
 
 int get_code_num(int channel, int object)
@@ -193,23 +218,24 @@ int get_code_num(int channel, int object)
 
 int get_object_data_length(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return 0;
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.dataLength();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return 0;
+	return (*o->objects)[object].dataLength();
 }
 
 int get_object_area(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return -1;
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.boundingBox().area();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return -1;
+	return o->area[object];
 }
 
 rectangle get_object_bbox(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return create_rectangle(-1, -1, 0, 0);
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.boundingBox().toCRectangle();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return create_rectangle(-1, -1, 0, 0);
+	return create_rectangle(o->bboxX[object], o->bboxY[object],
+		o->bboxWidth[object], o->bboxHeight[object]);
 }
 
 int get_object_bbox_ulx(int channel, int object)
@@ -246,9 +272,9 @@ int get_object_bbox_height(int channel, int object)
 
 point2 get_object_centroid(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return create_point2(-1, -1);
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.centroid().toCPoint2();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return create_point2(-1, -1);
+	return create_point2(o->centroidX[object], o->centroidY[object]);
 }
 
 int get_object_centroid_column(int channel, int object)
@@ -273,9 +299,10 @@ int get_object_centroid_y(int channel, int object)
 
 point2 get_object_center(int channel, int object)
 {
-	if(!check_channel_and_object(channel, object)) return create_point2(-1, -1);
-	const Camera::Object &o = (*DeviceSingleton::instance()->channels()[channel]->objects())[object];
-	return o.boundingBox().center().toCPoint2();
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return create_point2(-1, -1);
+	return create_point2(o->bboxX[object] + o->bboxWidth[object] / 2,
+		o->bboxY[object] + o->bboxHeight[object] / 2);
 }
 
 int get_object_center_column(int channel, int object)
@@ -298,8 +325,92 @@ int get_object_center_y(int channel, int object)
   return get_object_center(channel, object).y;
 }
 
+point3 get_object_world_centroid(int channel, int object)
+{
+	const ChannelObjects *const o = channel_objects(channel, object);
+	if(!o) return create_point3(-1, -1, -1);
+	Point3<int32_t> point(0, 0, 0);
+	if(!DeviceSingleton::instance()->worldCentroid((*o->objects)[object], point)) {
+		return create_point3(-1, -1, -1);
+	}
+	return point.toCPoint3();
+}
+
+int get_channel_objects(int channel, camera_object *objects, int max_objects)
+{
+	const ChannelObjects *const o = channel_objects(channel);
+	if(!o) return -1;
+	if(!objects || max_objects <= 0) return 0;
+	
+	const int count = std::min((int)o->count, max_objects);
+	for(int i = 0; i < count; ++i) {
+		camera_object &out = objects[i];
+		out.centroid = create_point2(o->centroidX[i], o->centroidY[i]);
+		out.center = create_point2(o->bboxX[i] + o->bboxWidth[i] / 2,
+			o->bboxY[i] + o->bboxHeight[i] / 2);
+		out.bbox = create_rectangle(o->bboxX[i], o->bboxY[i],
+			o->bboxWidth[i], o->bboxHeight[i]);
+		out.area = o->area[i];
+		out.confidence = o->confidence[i];
+	}
+	return count;
+}
+
+int set_object_tracking(int channel, int enabled)
+{
+	if(!check_channel(channel)) return 0;
+	DeviceSingleton::trackerTable()->setEnabled(channel, enabled != 0);
+	return 1;
+}
+
+static const Camera::ObjectTracker *channel_tracker(int channel)
+{
+	if(!check_channel(channel)) return 0;
+	const Camera::ObjectTracker *const ret = DeviceSingleton::trackerTable()->tracker(channel);
+	if(!ret) std::cout << "Object tracking isn't enabled on channel " << channel << std::endl;
+	return ret;
+}
+
+int get_tracked_object_count(int channel)
+{
+	const Camera::ObjectTracker *const tracker = channel_tracker(channel);
+	if(!tracker) return -1;
+	return tracker->objects().size();
+}
+
+int get_tracked_object_id(int channel, int index)
+{
+	const Camera::ObjectTracker *const tracker = channel_tracker(channel);
+	if(!tracker) return -1;
+	if(index < 0 || index >= (int)tracker->objects().size()) {
+		std::cout << "No such tracked object " << index << std::endl;
+		return -1;
+	}
+	return tracker->objects()[index].id();
+}
+
+point2 get_tracked_object_center(int channel, int id)
+{
+	const Camera::ObjectTracker *const tracker = channel_tracker(channel);
+	if(!tracker || id < 0) return create_point2(-1, -1);
+	const Camera::TrackedObject *const object = tracker->object(id);
+	if(!object) return create_point2(-1, -1);
+	return object->centroid().toCPoint2();
+}
+
+rectangle get_tracked_object_bbox(int channel, int id)
+{
+	const Camera::ObjectTracker *const tracker = channel_tracker(channel);
+	if(!tracker || id < 0) return create_rectangle(-1, -1, 0, 0);
+	const Camera::TrackedObject *const object = tracker->object(id);
+	if(!object) return create_rectangle(-1, -1, 0, 0);
+	const Rect<unsigned> &bbox = object->boundingBox();
+	return create_rectangle(bbox.x(), bbox.y(), bbox.width(), bbox.height());
+}
+
 void camera_close()
 {
+	DeviceSingleton::trackerTable()->clear();
 	DeviceSingleton::instance()->close();
 }
 
@@ -318,6 +429,13 @@ const unsigned char *get_camera_frame()
 	return DeviceSingleton::instance()->bgr();
 }
 
+unsigned get_camera_frame_stride()
+{
+	unsigned stride = 0;
+	DeviceSingleton::instance()->bgr(stride);
+	return stride;
+}
+
 unsigned get_camera_element_size()
 {
 	return DeviceSingleton::instance()->rawImage().elemSize();
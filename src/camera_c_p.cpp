@@ -2,6 +2,105 @@
 
 Camera::Device *Private::DeviceSingleton::s_device = 0;
 Camera::InputProvider *Private::DeviceSingleton::s_inputProvider = 0;
+Private::ObjectTable Private::DeviceSingleton::s_objectTable;
+Private::TrackerTable Private::DeviceSingleton::s_trackerTable;
+
+void Private::ChannelObjects::clear()
+{
+	valid = false;
+	count = 0;
+	objects = 0;
+}
+
+void Private::ChannelObjects::assign(const Camera::ObjectVector *const objects)
+{
+	this->objects = objects;
+	valid = true;
+	count = objects ? objects->size() : 0;
+	
+	// resize() keeps the capacity, so this only allocates when a channel
+	// has more objects than ever before
+	centroidX.resize(count);
+	centroidY.resize(count);
+	bboxX.resize(count);
+	bboxY.resize(count);
+	bboxWidth.resize(count);
+	bboxHeight.resize(count);
+	area.resize(count);
+	confidence.resize(count);
+	
+	for(unsigned i = 0; i < count; ++i) {
+		const Camera::Object &o = (*objects)[i];
+		const Rect<unsigned> &bbox = o.boundingBox();
+		centroidX[i] = o.centroid().x();
+		centroidY[i] = o.centroid().y();
+		bboxX[i] = bbox.x();
+		bboxY[i] = bbox.y();
+		bboxWidth[i] = bbox.width();
+		bboxHeight[i] = bbox.height();
+		area[i] = bbox.area();
+		confidence[i] = o.confidence();
+	}
+}
+
+void Private::ObjectTable::invalidate()
+{
+	std::vector<ChannelObjects>::iterator it = m_channels.begin();
+	for(; it != m_channels.end(); ++it) it->clear();
+}
+
+const Private::ChannelObjects *Private::ObjectTable::channel(const int channel)
+{
+	const Camera::ChannelPtrVector &channels = DeviceSingleton::instance()->channels();
+	if(channel < 0 || channel >= (int)channels.size()) return 0;
+	
+	if(m_channels.size() != channels.size()) {
+		m_channels.resize(channels.size());
+		invalidate();
+	}
+	
+	ChannelObjects &ret = m_channels[channel];
+	if(!ret.valid) ret.assign(channels[channel]->objects());
+	return &ret;
+}
+
+Private::TrackerTable::~TrackerTable()
+{
+	clear();
+}
+
+void Private::TrackerTable::setEnabled(const int channel, const bool enabled)
+{
+	const Camera::ChannelPtrVector &channels = DeviceSingleton::instance()->channels();
+	if(channel < 0 || channel >= (int)channels.size()) return;
+	if(m_trackers.size() < channels.size()) m_trackers.resize(channels.size(), 0);
+	
+	Camera::ObjectTracker *&tracker = m_trackers[channel];
+	if(tracker && (!enabled || tracker->channel() != channels[channel])) {
+		delete tracker;
+		tracker = 0;
+	}
+	if(enabled && !tracker) tracker = new Camera::ObjectTracker(channels[channel]);
+}
+
+const Camera::ObjectTracker *Private::TrackerTable::tracker(const int channel) const
+{
+	if(channel < 0 || channel >= (int)m_trackers.size()) return 0;
+	return m_trackers[channel];
+}
+
+void Private::TrackerTable::update()
+{
+	std::vector<Camera::ObjectTracker *>::iterator it = m_trackers.begin();
+	for(; it != m_trackers.end(); ++it) if(*it) (*it)->update();
+}
+
+void Private::TrackerTable::clear()
+{
+	std::vector<Camera::ObjectTracker *>::iterator it = m_trackers.begin();
+	for(; it != m_trackers.end(); ++it) delete *it;
+	m_trackers.clear();
+}
 
 void Private::DeviceSingleton::setInputProvider(Camera::InputProvider *const inputProvider)
 {
@@ -10,10 +109,22 @@ void Private::DeviceSingleton::setInputProvider(Camera::InputProvider *const inp
 	
 	delete s_device;
 	s_device = 0;
+	s_objectTable.invalidate();
+	s_trackerTable.clear();
 }
 
 Camera::Device *Private::DeviceSingleton::instance()
 {
 	if(!s_device) s_device = new Camera::Device(s_inputProvider);
 	return s_device;
-}
\ No newline at end of file
+}
+
+Private::ObjectTable *Private::DeviceSingleton::objectTable()
+{
+	return &s_objectTable;
+}
+
+Private::TrackerTable *Private::DeviceSingleton::trackerTable()
+{
+	return &s_trackerTable;
+}
@@ -2,19 +2,93 @@
 #define _CAMERA_C_P_HPP_
 
 #include "kovan/camera.hpp"
+#include "kovan/object_tracker.hpp"
+
+#include <vector>
 
 namespace Private
 {
+	/**
+	 * The objects of one channel, flattened into one array per field
+	 */
+	struct ChannelObjects
+	{
+		void clear();
+		void assign(const ::Camera::ObjectVector *const objects);
+		
+		bool valid;
+		unsigned count;
+		std::vector<int> centroidX;
+		std::vector<int> centroidY;
+		std::vector<int> bboxX;
+		std::vector<int> bboxY;
+		std::vector<int> bboxWidth;
+		std::vector<int> bboxHeight;
+		std::vector<int> area;
+		std::vector<double> confidence;
+		const ::Camera::ObjectVector *objects;
+	};
+	
+	/**
+	 * Per-frame cache of every channel's objects backing the C camera
+	 * API. A channel is flattened the first time it's queried after
+	 * invalidate(), so the getters are plain indexed loads afterwards.
+	 */
+	class ObjectTable
+	{
+	public:
+		void invalidate();
+		
+		/**
+		 * \return the objects of the given channel, or 0 if there is no such channel
+		 */
+		const ChannelObjects *channel(const int channel);
+		
+	private:
+		std::vector<ChannelObjects> m_channels;
+	};
+	
+	/**
+	 * The object trackers enabled through the C camera API, one per
+	 * channel at most. Trackers keep pointers to their channels, so they
+	 * are dropped whenever the device's channels are replaced.
+	 */
+	class TrackerTable
+	{
+	public:
+		~TrackerTable();
+		
+		void setEnabled(const int channel, const bool enabled);
+		
+		/**
+		 * \return the tracker of the given channel, or 0 if it has none
+		 */
+		const ::Camera::ObjectTracker *tracker(const int channel) const;
+		
+		/**
+		 * Feeds the current frame to every tracker
+		 */
+		void update();
+		void clear();
+		
+	private:
+		std::vector< ::Camera::ObjectTracker *> m_trackers;
+	};
+	
 	class DeviceSingleton
 	{
 	public:
 		static void setInputProvider(::Camera::InputProvider *const inputProvider);
 		
 		static ::Camera::Device *instance();
+		static ObjectTable *objectTable();
+		static TrackerTable *trackerTable();
 		
 	private:
 		static ::Camera::Device *s_device;
 		static ::Camera::InputProvider *s_inputProvider;
+		static ObjectTable s_objectTable;
+		static TrackerTable s_trackerTable;
 	};
 }
 
@@ -0,0 +1,116 @@
+#include "kovan/camera_profiler.hpp"
+
+#include <opencv2/core/core.hpp>
+#include <iomanip>
+
+using namespace Camera;
+
+Profiler::Scope::Scope(const Stage stage)
+	: m_stage(stage),
+	m_start(Profiler::instance()->isEnabled() ? cv::getTickCount() : 0)
+{
+}
+
+Profiler::Scope::~Scope()
+{
+	if(!m_start) return;
+	Profiler::instance()->add(m_stage, (cv::getTickCount() - m_start) / cv::getTickFrequency());
+}
+
+Profiler *Profiler::instance()
+{
+	static Profiler s_profiler;
+	return &s_profiler;
+}
+
+void Profiler::setEnabled(const bool enabled)
+{
+	m_enabled = enabled;
+}
+
+bool Profiler::isEnabled() const
+{
+	return m_enabled;
+}
+
+void Profiler::reset()
+{
+	m_mutex.lock();
+	for(unsigned i = 0; i < StageCount; ++i) {
+		m_counts[i] = 0;
+		m_totals[i] = 0.0;
+	}
+	m_mutex.unlock();
+}
+
+void Profiler::add(const Stage stage, const double seconds)
+{
+	if(stage >= StageCount) return;
+	m_mutex.lock();
+	++m_counts[stage];
+	m_totals[stage] += seconds;
+	m_mutex.unlock();
+}
+
+unsigned Profiler::count(const Stage stage) const
+{
+	if(stage >= StageCount) return 0;
+	m_mutex.lock();
+	const unsigned ret = m_counts[stage];
+	m_mutex.unlock();
+	return ret;
+}
+
+double Profiler::total(const Stage stage) const
+{
+	if(stage >= StageCount) return 0.0;
+	m_mutex.lock();
+	const double ret = m_totals[stage];
+	m_mutex.unlock();
+	return ret;
+}
+
+double Profiler::average(const Stage stage) const
+{
+	if(stage >= StageCount) return 0.0;
+	m_mutex.lock();
+	const double ret = m_counts[stage] ? m_totals[stage] / m_counts[stage] : 0.0;
+	m_mutex.unlock();
+	return ret;
+}
+
+void Profiler::report(std::ostream &out) const
+{
+	out << std::left << std::setw(16) << "stage"
+		<< std::right << std::setw(10) << "calls"
+		<< std::setw(14) << "total (ms)"
+		<< std::setw(14) << "avg (ms)" << std::endl;
+
+	for(unsigned i = 0; i < StageCount; ++i) {
+		const Stage stage = static_cast<Stage>(i);
+		out << std::left << std::setw(16) << stageName(stage)
+			<< std::right << std::setw(10) << count(stage)
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(14) << total(stage) * 1000.0
+			<< std::setw(14) << average(stage) * 1000.0 << std::endl;
+	}
+}
+
+const char *Profiler::stageName(const Stage stage)
+{
+	switch(stage) {
+	case Capture: return "capture";
+	case Conversion: return "conversion";
+	case Threshold: return "threshold";
+	case BlobExtraction: return "blob extraction";
+	case Sort: return "sort";
+	default: break;
+	}
+	return "unknown";
+}
+
+Profiler::Profiler()
+	: m_enabled(false)
+{
+	reset();
+}
@@ -1,5 +1,6 @@
 #include "channel_p.hpp"
 #include "warn.hpp"
+#include "kovan/camera_profiler.hpp"
 #include <opencv2/features2d/features2d.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -14,20 +15,15 @@ HsvChannelImpl::HsvChannelImpl()
 
 void HsvChannelImpl::update(const cv::Mat &image)
 {
-	if(image.empty()) {
-		m_image = cv::Mat();
-		return;
-	}
-#if CV_VERSION_EPOCH == 3
-  cv::cvtColor(image, m_image, cv::COLOR_BGR2HSV);
-#else
-  cv::cvtColor(image, m_image, CV_BGR2HSV);
-#endif
+	// Converting to HSV is deferred to findObjects(), since channels using a
+	// lookup table classify the BGR image directly
+	m_bgr = image;
+	m_image = cv::Mat();
 }
 
-Camera::ObjectVector HsvChannelImpl::findObjects(const Config &config)
+void HsvChannelImpl::findObjects(const Config &config, ::Camera::ObjectVector &objects)
 {
-	if(m_image.empty()) return ::Camera::ObjectVector();
+	if(m_bgr.empty()) return;
   
 	// TODO: This lookup is really slow compared to the rest of
 	// the algorithm.
@@ -38,52 +34,138 @@ Camera::ObjectVector HsvChannelImpl::findObjects(const Config &config)
 	
 	// std::cout << "top: <" << top[0] << ", " << top[1] << ", " << top[2] << ">" << std::endl;
 	
-	cv::Mat fixed = m_image;
-	if(bottom[0] > top[0]) {
-		// Modulo 180
-		// TODO: Optimize for ARM?
-		const uchar adjH = 180 - bottom[0];
-		for(int i = 0; i < fixed.rows; ++i) {
-			uchar *row = fixed.ptr<uchar>(i);
-			for(int j = 0; j < fixed.cols; ++j) {
-				row[j * fixed.elemSize()] += adjH;
-				row[j * fixed.elemSize()] %= 180;
+	if(config.boolValue(CAMERA_CHANNEL_LUT_KEY)) {
+		// Mask the frame's shared labels if the device compiled this range
+		// into its color table; otherwise classify with a private table
+		if(!maskLabels(bottom, top, m_only)) {
+			int bit = m_colorTable.add(bottom, top);
+			if(bit < 0) {
+				// Full of ranges no longer in use, most likely
+				m_colorTable.clear();
+				bit = m_colorTable.add(bottom, top);
 			}
+			::Camera::Profiler::Scope scope(::Camera::Profiler::Threshold);
+			m_colorTable.classify(m_bgr, bit, m_only);
 		}
-		
-		cv::Vec3b adj(adjH, 0, 0);
-		bottom = cv::Vec3b(0, bottom[1], bottom[2]);
-		cv::add(adj, top, top);
+	} else {
+		if(m_image.empty()) convert();
+		::Camera::Profiler::Scope scope(::Camera::Profiler::Threshold);
+		threshold(m_image, bottom, top, m_only);
 	}
 	
-	cv::Mat only;
-	cv::inRange(fixed, bottom, top, only);
-	
-	std::vector<std::vector<cv::Point> > c;
+	::Camera::Profiler::Scope scope(::Camera::Profiler::BlobExtraction);
+	std::vector<std::vector<cv::Point> > &c = m_contours;
 #if CV_VERSION_EPOCH == 3
-  cv::findContours(only, c, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_TC89_L1);
+  cv::findContours(m_only, c, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_TC89_L1);
 #else
-  cv::findContours(only, c, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_TC89_L1);
+  cv::findContours(m_only, c, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_TC89_L1);
 #endif
 	
-	std::vector<cv::Moments> m(c.size());
-	for(std::vector<cv::Moments>::size_type i = 0; i < c.size(); ++i) {
-		m[i] = cv::moments(c[i], false);
-	}
-	
-	::Camera::ObjectVector ret;
-	for(::Camera::ObjectVector::size_type i = 0; i < c.size(); ++i) {
+	for(std::vector<std::vector<cv::Point> >::size_type i = 0; i < c.size(); ++i) {
 		const cv::Rect rect = cv::boundingRect(c[i]);
 		if(rect.width < 3 && rect.height < 3) continue;
 		
-		ret.push_back(::Camera::Object(Point2<unsigned>(m[i].m10 / m[i].m00, m[i].m01 / m[i].m00),
+		const cv::Moments m = cv::moments(c[i], false);
+		objects.push_back(::Camera::Object(Point2<unsigned>(m.m10 / m.m00, m.m01 / m.m00),
 			Rect<unsigned>(rect.x, rect.y, rect.width, rect.height), 1.0));
 	}
+}
+
+void HsvChannelImpl::convert()
+{
+	// The cached conversion is shared, so findObjects() must not modify it
+	if(frameCache() && frameCache()->isFrame(m_bgr)) {
+#if CV_VERSION_EPOCH == 3
+		m_image = frameCache()->converted(cv::COLOR_BGR2HSV);
+#else
+		m_image = frameCache()->converted(CV_BGR2HSV);
+#endif
+		return;
+	}
+	
+	::Camera::Profiler::Scope scope(::Camera::Profiler::Conversion);
+#if CV_VERSION_EPOCH == 3
+  cv::cvtColor(m_bgr, m_image, cv::COLOR_BGR2HSV);
+#else
+  cv::cvtColor(m_bgr, m_image, CV_BGR2HSV);
+#endif
+}
+
+void HsvChannelImpl::threshold(const cv::Mat &hsv, const cv::Vec3b &bottom,
+	const cv::Vec3b &top, cv::Mat &mask)
+{
+	if(bottom[0] > top[0]) {
+		// The hue range wraps around 180
+		cv::inRange(hsv, cv::Scalar(bottom[0], bottom[1], bottom[2]),
+			cv::Scalar(180, top[1], top[2]), mask);
+		cv::inRange(hsv, cv::Scalar(0, bottom[1], bottom[2]),
+			cv::Scalar(top[0], top[1], top[2]), m_wrapped);
+		cv::bitwise_or(mask, m_wrapped, mask);
+	} else cv::inRange(hsv, bottom, top, mask);
+}
+
+bool HsvChannelImpl::maskLabels(const cv::Vec3b &bottom, const cv::Vec3b &top, cv::Mat &mask)
+{
+	::Camera::FrameCache *const cache = frameCache();
+	if(!cache || !cache->colorTable()) return false;
+	
+	const int bit = cache->colorTable()->bit(bottom, top);
+	if(bit < 0) return false;
 	
-	return ret;
+	// The image may be a window into the frame, but not a scaled copy
+	const cv::Mat &frame = cache->image();
+	if(frame.empty() || m_bgr.datastart != frame.datastart) return false;
+	cv::Size whole;
+	cv::Point offset;
+	m_bgr.locateROI(whole, offset);
+	if(whole != frame.size()) return false;
+	
+	const cv::Mat &labels = cache->labels();
+	if(labels.empty()) return false;
+	
+	::Camera::Profiler::Scope scope(::Camera::Profiler::Threshold);
+	const cv::Mat window = labels(cv::Rect(offset.x, offset.y, m_bgr.cols, m_bgr.rows));
+	const unsigned int flag = 1U << bit;
+	mask.create(window.rows, window.cols, CV_8UC1);
+	for(int y = 0; y < window.rows; ++y) {
+		const unsigned int *const src = window.ptr<unsigned int>(y);
+		uchar *const dst = mask.ptr<uchar>(y);
+		for(int x = 0; x < window.cols; ++x) dst[x] = (src[x] & flag) ? 255 : 0;
+	}
+	return true;
+}
+
+// Scan the whole frame this often when scan_regions finds no candidates
+#define BARCODE_FULL_SCAN_INTERVAL 10
+
+// Mean absolute pixel difference below which a code is assumed to be
+// unchanged
+#define BARCODE_UNCHANGED_THRESHOLD 4
+
+BarcodeChannelImpl::CachedSymbol::CachedSymbol(const cv::Rect &region, const cv::Mat &pixels,
+	const ::Camera::Object &object)
+	: region(region),
+	pixels(pixels),
+	object(object)
+{
+}
+
+BarcodeChannelImpl::ScanState::ScanState()
+{
+	reset();
+}
+
+void BarcodeChannelImpl::ScanState::reset()
+{
+	valid = false;
+	lastScan = 0;
+	scansSinceFullScan = 0;
+	results.clear();
+	cache.clear();
 }
 
 BarcodeChannelImpl::BarcodeChannelImpl()
+	: m_updates(0)
 {
 	m_image.set_format("Y800");
 	m_scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 0);
@@ -92,37 +174,89 @@ BarcodeChannelImpl::BarcodeChannelImpl()
 
 void BarcodeChannelImpl::update(const cv::Mat &image)
 {
-	if(image.empty()) {
-		m_gray = cv::Mat();
+	++m_updates;
+	
+	// Converting to gray is deferred to findObjects(), so frames between
+	// scans aren't converted at all
+	m_bgr = image;
+	m_gray = cv::Mat();
+}
+
+void BarcodeChannelImpl::findObjects(const Config &config, ::Camera::ObjectVector &objects)
+{
+	if(m_bgr.empty()) {
+		m_states.clear();
 		return;
 	}
+	
+	const int interval = std::max(config.intValue("scan_interval"), 1);
+	const bool regions = config.boolValue("scan_regions");
+	ScanState &state = m_states[ScanKey(interval, regions)];
+	
+	cv::Size frameSize;
+	cv::Point offset;
+	m_bgr.locateROI(frameSize, offset);
+	const cv::Rect window(offset.x, offset.y, m_bgr.cols, m_bgr.rows);
+	if(window != state.window || frameSize != state.frameSize) {
+		state.reset();
+		state.window = window;
+		state.frameSize = frameSize;
+	}
+	
+	const unsigned long frame = frameNumber();
+	if(!state.valid || frame - state.lastScan >= (unsigned long)interval) {
+		convert();
+		state.results.clear();
+		if(regions) scanRegions(state);
+		else scan(m_image, cv::Point(0, 0), state.results);
+		state.lastScan = frame;
+		state.valid = true;
+	}
+	
+	objects.insert(objects.end(), state.results.begin(), state.results.end());
+}
+
+unsigned long BarcodeChannelImpl::frameNumber() const
+{
+	return frameCache() ? frameCache()->frameNumber() : m_updates;
+}
+
+void BarcodeChannelImpl::convert()
+{
+	if(!m_gray.empty()) return;
+	
+	if(frameCache() && frameCache()->isFrame(m_bgr)) {
+#if CV_VERSION_EPOCH == 3
+		m_gray = frameCache()->converted(cv::COLOR_BGR2GRAY);
+#else
+		m_gray = frameCache()->converted(CV_BGR2GRAY);
+#endif
+	} else {
 #if CV_VERSION_EPOCH == 3
-  cv::cvtColor(image, m_gray, cv::COLOR_BGR2GRAY);
+		cv::cvtColor(m_bgr, m_gray, cv::COLOR_BGR2GRAY);
 #else
-  cv::cvtColor(image, m_gray, CV_BGR2GRAY);
+		cv::cvtColor(m_bgr, m_gray, CV_BGR2GRAY);
 #endif
+	}
 	m_image.set_data(m_gray.data, m_gray.cols * m_gray.rows);
 	m_image.set_size(m_gray.cols, m_gray.rows);
 }
 
-::Camera::ObjectVector BarcodeChannelImpl::findObjects(const Config &config)
+void BarcodeChannelImpl::scan(zbar::Image &image, const cv::Point &offset,
+	::Camera::ObjectVector &objects)
 {
-	if(m_gray.empty()) return ::Camera::ObjectVector();
-	
-	m_scanner.scan(m_image);
+	m_scanner.scan(image);
 	zbar::SymbolSet symbols = m_scanner.get_results();
-	::Camera::ObjectVector ret;
 	zbar::SymbolIterator it = symbols.symbol_begin();
 	for(; it != symbols.symbol_end(); ++it) {
 		zbar::Symbol symbol = *it;
 		
 		// Determine bounding box and centroid
-		int left = m_image.get_width();
+		int left = image.get_width();
 		int right = 0;
-		int bottom = m_image.get_height();
+		int bottom = image.get_height();
 		int top = 0;
 		
-		zbar::Symbol::PointIterator pit = symbol.point_begin();
 		for(int i = 0; i < symbol.get_location_size(); ++i) {
 			const int &x = symbol.get_location_x(i);
 			if(x > right) right = x;
@@ -133,11 +267,138 @@ void BarcodeChannelImpl::update(const cv::Mat &image)
 			if(y < bottom) bottom = y;
 		}
 		
-		ret.push_back(::Camera::Object(Point2<unsigned>((left + right) / 2, (top + bottom) / 2),
+		left += offset.x;
+		right += offset.x;
+		bottom += offset.y;
+		top += offset.y;
+		
+		objects.push_back(::Camera::Object(Point2<unsigned>((left + right) / 2, (top + bottom) / 2),
 			Rect<unsigned>(left, bottom, right - left, top - bottom),
 			1.0, zbar_symbol_get_data(symbol),
 			zbar_symbol_get_data_length(symbol)));
 	}
+}
+
+void BarcodeChannelImpl::scanRegions(ScanState &state)
+{
+	::Camera::ObjectVector &objects = state.results;
+	
+	// Codes that didn't change since the last scan don't need zbar
+	m_previous.swap(state.cache);
+	state.cache.clear();
+	m_regions.clear();
+	std::vector<CachedSymbol>::const_iterator it = m_previous.begin();
+	for(; it != m_previous.end(); ++it) {
+		const double diff = cv::norm(m_gray(it->region), it->pixels, cv::NORM_L1);
+		if(diff <= (double)it->region.area() * BARCODE_UNCHANGED_THRESHOLD) {
+			objects.push_back(it->object);
+			state.cache.push_back(*it);
+		} else m_regions.push_back(it->region);
+	}
+	
+	findCandidates(m_regions);
+	
+	if(m_regions.empty()) {
+		if(!objects.empty() || ++state.scansSinceFullScan < BARCODE_FULL_SCAN_INTERVAL) return;
+		state.scansSinceFullScan = 0;
+		
+		m_found.clear();
+		scan(m_image, cv::Point(0, 0), m_found);
+		for(::Camera::ObjectVector::const_iterator fit = m_found.begin(); fit != m_found.end(); ++fit) {
+			objects.push_back(*fit);
+			cache(state, *fit);
+		}
+		return;
+	}
 	
-	return ret;
-}
\ No newline at end of file
+	std::vector<cv::Rect>::const_iterator rit = m_regions.begin();
+	for(; rit != m_regions.end(); ++rit) {
+		m_gray(*rit).copyTo(m_crop);
+		zbar::Image crop(m_crop.cols, m_crop.rows, "Y800", m_crop.data, m_crop.cols * m_crop.rows);
+		
+		m_found.clear();
+		scan(crop, rit->tl(), m_found);
+		
+		::Camera::ObjectVector::const_iterator fit = m_found.begin();
+		for(; fit != m_found.end(); ++fit) {
+			// Overlapping regions can contain the same code
+			bool duplicate = false;
+			::Camera::ObjectVector::const_iterator oit = objects.begin();
+			for(; oit != objects.end() && !duplicate; ++oit) {
+				const Rect<unsigned> &b = oit->boundingBox();
+				const Point2<unsigned> &c = fit->centroid();
+				duplicate = c.x() >= b.x() && c.x() <= b.x() + b.width()
+					&& c.y() >= b.y() && c.y() <= b.y() + b.height();
+			}
+			if(duplicate) continue;
+			
+			objects.push_back(*fit);
+			cache(state, *fit);
+		}
+	}
+}
+
+void BarcodeChannelImpl::findCandidates(std::vector<cv::Rect> &regions)
+{
+	if(m_gray.cols < 32 || m_gray.rows < 32) return;
+	
+	// QR finder patterns are a dark square inside of a light ring inside of
+	// a dark ring, i.e. contours nested at least two levels deep. Look for
+	// them at half resolution.
+#if CV_VERSION_EPOCH == 3
+	cv::resize(m_gray, m_small, cv::Size(m_gray.cols / 2, m_gray.rows / 2), 0, 0, cv::INTER_AREA);
+	cv::adaptiveThreshold(m_small, m_binary, 255, cv::ADAPTIVE_THRESH_MEAN_C,
+		cv::THRESH_BINARY_INV, 15, 10);
+	cv::findContours(m_binary, m_contours, m_hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+#else
+	cv::resize(m_gray, m_small, cv::Size(m_gray.cols / 2, m_gray.rows / 2), 0, 0, CV_INTER_AREA);
+	cv::adaptiveThreshold(m_small, m_binary, 255, CV_ADAPTIVE_THRESH_MEAN_C,
+		CV_THRESH_BINARY_INV, 15, 10);
+	cv::findContours(m_binary, m_contours, m_hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);
+#endif
+	
+	const cv::Rect frame(0, 0, m_gray.cols, m_gray.rows);
+	for(std::vector<std::vector<cv::Point> >::size_type i = 0; i < m_contours.size(); ++i) {
+		int depth = 0;
+		for(int c = m_hierarchy[i][2]; c >= 0 && depth < 2; c = m_hierarchy[c][2]) ++depth;
+		if(depth < 2) continue;
+		
+		const cv::Rect r = cv::boundingRect(m_contours[i]);
+		if(r.width < 3 || r.height < 3) continue;
+		if(r.width > 2 * r.height || r.height > 2 * r.width) continue;
+		
+		// The rest of the code can extend roughly three finder pattern
+		// widths away from each finder pattern
+		cv::Rect region(2 * (r.x - 3 * r.width), 2 * (r.y - 3 * r.height),
+			14 * r.width, 14 * r.height);
+		region &= frame;
+		if(region.area() <= 0) continue;
+		
+		bool merged = false;
+		std::vector<cv::Rect>::iterator it = regions.begin();
+		for(; it != regions.end() && !merged; ++it) {
+			if((region & *it).area() * 2 < region.area()) continue;
+			*it = *it | region;
+			merged = true;
+		}
+		if(!merged) regions.push_back(region);
+	}
+}
+
+void BarcodeChannelImpl::cache(ScanState &state, const ::Camera::Object &object)
+{
+	const cv::Rect region = padded(object.boundingBox());
+	if(region.area() <= 0) return;
+	state.cache.push_back(CachedSymbol(region, m_gray(region).clone(), object));
+}
+
+cv::Rect BarcodeChannelImpl::padded(const Rect<unsigned> &rect) const
+{
+	const int x = rect.x();
+	const int y = rect.y();
+	const int w = rect.width();
+	const int h = rect.height();
+	const int pad = std::max(w, h) / 4 + 8;
+	return cv::Rect(x - pad, y - pad, w + 2 * pad, h + 2 * pad)
+		& cv::Rect(0, 0, m_gray.cols, m_gray.rows);
+}
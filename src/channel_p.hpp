@@ -5,33 +5,127 @@
 #include <opencv2/core/core.hpp>
 #include <zbar.h>
 #include <map>
+#include <vector>
 
 namespace Private
 {
 	namespace Camera
 	{
+		/**
+		 * Finds blobs within an HSV range. Supports these channel keys:
+		 *   th, ts, tv,
+		 *   bh, bs, bv - the upper and lower bounds of the range. The hue
+		 *                range wraps around if bh > th.
+		 *   lut        - classify pixels through a table indexed by the
+		 *                quantized BGR value instead of converting the
+		 *                image to HSV. Uses the device's shared color
+		 *                table when it holds the range, a private one
+		 *                otherwise.
+		 */
 		class HsvChannelImpl : public ::Camera::ChannelImpl
 		{
 		public:
 			HsvChannelImpl();
 			virtual void update(const cv::Mat &image);
-			virtual ::Camera::ObjectVector findObjects(const Config &config);
+			using ::Camera::ChannelImpl::findObjects;
+			virtual void findObjects(const Config &config, ::Camera::ObjectVector &objects);
 			
 		private:
+			void convert();
+			void threshold(const cv::Mat &hsv, const cv::Vec3b &bottom,
+				const cv::Vec3b &top, cv::Mat &mask);
+			bool maskLabels(const cv::Vec3b &bottom, const cv::Vec3b &top, cv::Mat &mask);
+			
+			cv::Mat m_bgr;
 			cv::Mat m_image;
+			
+			// Ranges the device's color table doesn't hold
+			::Camera::ColorTable m_colorTable;
+			
+			// Scratch space reused between frames
+			cv::Mat m_only;
+			cv::Mat m_wrapped;
+			std::vector<std::vector<cv::Point> > m_contours;
 		};
 		
+		/**
+		 * Finds QR codes with zbar. Supports these channel keys:
+		 *   scan_interval - run zbar only every nth frame, reusing the
+		 *                   last results in between (default 1)
+		 *   scan_regions  - only scan padded crops around previously found
+		 *                   codes and around likely finder patterns
+		 *                   instead of the whole frame
+		 * Results are kept per combination of these keys, so channels
+		 * configured differently don't share them.
+		 */
 		class BarcodeChannelImpl : public ::Camera::ChannelImpl
 		{
 		public:
 			BarcodeChannelImpl();
 			virtual void update(const cv::Mat &image);
-			virtual ::Camera::ObjectVector findObjects(const Config &config);
+			using ::Camera::ChannelImpl::findObjects;
+			virtual void findObjects(const Config &config, ::Camera::ObjectVector &objects);
 
 		private:
+			struct CachedSymbol
+			{
+				CachedSymbol(const cv::Rect &region, const cv::Mat &pixels,
+					const ::Camera::Object &object);
+				
+				cv::Rect region;
+				cv::Mat pixels;
+				::Camera::Object object;
+			};
+			
+			// The results of one scan_interval and scan_regions combination
+			struct ScanState
+			{
+				ScanState();
+				void reset();
+				
+				bool valid;
+				unsigned long lastScan;
+				unsigned scansSinceFullScan;
+				
+				// Where in its frame the scanned image was, since results
+				// don't carry over to another window
+				cv::Rect window;
+				cv::Size frameSize;
+				
+				::Camera::ObjectVector results;
+				std::vector<CachedSymbol> cache;
+			};
+			
+			typedef std::pair<int, bool> ScanKey;
+			
+			unsigned long frameNumber() const;
+			void convert();
+			void scan(zbar::Image &image, const cv::Point &offset, ::Camera::ObjectVector &objects);
+			void scanRegions(ScanState &state);
+			void findCandidates(std::vector<cv::Rect> &regions);
+			void cache(ScanState &state, const ::Camera::Object &object);
+			cv::Rect padded(const Rect<unsigned> &rect) const;
+			
+			cv::Mat m_bgr;
 			cv::Mat m_gray;
 			zbar::Image m_image;
 			zbar::ImageScanner m_scanner;
+			
+			// Counts update() calls when there is no frame cache to get the
+			// device's frame number from
+			unsigned long m_updates;
+			
+			std::map<ScanKey, ScanState> m_states;
+			
+			// Scratch space reused between frames
+			std::vector<CachedSymbol> m_previous;
+			::Camera::ObjectVector m_found;
+			cv::Mat m_small;
+			cv::Mat m_binary;
+			cv::Mat m_crop;
+			std::vector<cv::Rect> m_regions;
+			std::vector<std::vector<cv::Point> > m_contours;
+			std::vector<cv::Vec4i> m_hierarchy;
 		};
 	}
 }
@@ -0,0 +1,116 @@
+#include "channel_worker_p.hpp"
+#include "warn.hpp"
+
+#include <map>
+
+using namespace Private;
+
+ChannelWorker::ChannelWorker(ChannelWorkerPool *const pool)
+	: m_pool(pool),
+	m_pending(false),
+	m_running(false)
+{
+}
+
+void ChannelWorker::clear()
+{
+	m_channels.clear();
+}
+
+void ChannelWorker::add(const ::Camera::Channel *const channel)
+{
+	m_channels.push_back(channel);
+}
+
+void ChannelWorker::evaluate()
+{
+	std::vector<const ::Camera::Channel *>::const_iterator it = m_channels.begin();
+	for(; it != m_channels.end(); ++it) (*it)->evaluate();
+}
+
+void ChannelWorker::run()
+{
+	m_pool->m_mutex.lock();
+	for(;;) {
+		while(!m_pending && !m_pool->m_stop) m_pool->m_wake.wait(m_pool->m_mutex);
+		if(m_pool->m_stop) break;
+		m_pool->m_mutex.unlock();
+		
+		evaluate();
+		
+		m_pool->m_mutex.lock();
+		m_pending = false;
+		if(!--m_pool->m_remaining) m_pool->m_done.signal();
+	}
+	m_pool->m_mutex.unlock();
+}
+
+ChannelWorkerPool::ChannelWorkerPool()
+	: m_remaining(0),
+	m_stop(false)
+{
+}
+
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+	m_mutex.lock();
+	m_stop = true;
+	m_wake.broadcast();
+	m_mutex.unlock();
+	
+	std::vector<ChannelWorker *>::const_iterator it = m_workers.begin();
+	for(; it != m_workers.end(); ++it) {
+		if((*it)->m_running) (*it)->join();
+		delete *it;
+	}
+}
+
+void ChannelWorkerPool::evaluate(const ::Camera::ChannelPtrVector &channels)
+{
+	std::map< ::Camera::ChannelImpl *, ChannelWorker *> groups;
+	std::vector<ChannelWorker *>::size_type used = 0;
+	::Camera::ChannelPtrVector::const_iterator it = channels.begin();
+	for(; it != channels.end(); ++it) {
+		::Camera::ChannelImpl *const impl = (*it)->channelImpl();
+		if(!impl || !(*it)->isInDemand()) continue;
+		
+		ChannelWorker *&worker = groups[impl];
+		if(!worker) {
+			if(used == m_workers.size()) {
+				ChannelWorker *const w = new ChannelWorker(this);
+				// The first group runs on the calling thread and needs none
+				if(!m_workers.empty()) {
+					w->m_running = w->start();
+					if(!w->m_running) WARN("Starting a channel worker failed, evaluating serially");
+				}
+				m_workers.push_back(w);
+			}
+			worker = m_workers[used++];
+			worker->clear();
+		}
+		worker->add(*it);
+	}
+	
+	if(!used) return;
+	
+	// Idle workers only touch their channels once woken, so handing them
+	// out above is safe
+	m_mutex.lock();
+	for(std::vector<ChannelWorker *>::size_type i = 1; i < used; ++i) {
+		if(!m_workers[i]->m_running) continue;
+		m_workers[i]->m_pending = true;
+		++m_remaining;
+	}
+	if(m_remaining) m_wake.broadcast();
+	m_mutex.unlock();
+	
+	m_workers[0]->evaluate();
+	for(std::vector<ChannelWorker *>::size_type i = 1; i < used; ++i) {
+		if(!m_workers[i]->m_running) m_workers[i]->evaluate();
+	}
+	
+	// Wait until every woken worker is done
+	m_mutex.lock();
+	while(m_remaining) m_done.wait(m_mutex);
+	m_mutex.unlock();
+}
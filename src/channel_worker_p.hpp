@@ -0,0 +1,72 @@
+#ifndef _CHANNEL_WORKER_P_HPP_
+#define _CHANNEL_WORKER_P_HPP_
+
+#include "kovan/camera.hpp"
+#include "kovan/thread.hpp"
+
+#include <vector>
+
+namespace Private
+{
+	class ChannelWorkerPool;
+	
+	/**
+	 * Evaluates a group of channels. All channels sharing a ChannelImpl
+	 * must be put into the same worker, since impls aren't thread safe.
+	 * Once started, the worker's thread sleeps until its pool hands it a
+	 * frame.
+	 */
+	class ChannelWorker : public Thread
+	{
+	public:
+		ChannelWorker(ChannelWorkerPool *const pool);
+		
+		void clear();
+		void add(const ::Camera::Channel *const channel);
+		
+		// Evaluates the channels on the calling thread
+		void evaluate();
+		
+		virtual void run();
+		
+	private:
+		friend class ChannelWorkerPool;
+		
+		ChannelWorkerPool *m_pool;
+		std::vector<const ::Camera::Channel *> m_channels;
+		
+		// Guarded by the pool's mutex
+		bool m_pending;
+		bool m_running;
+	};
+	
+	class ChannelWorkerPool
+	{
+	public:
+		ChannelWorkerPool();
+		
+		// Stops and joins all worker threads
+		~ChannelWorkerPool();
+		
+		/**
+		 * Evaluates all channels in demand, one thread per distinct
+		 * ChannelImpl. The first group runs on the calling thread, the
+		 * others on threads started once and reused for every frame.
+		 * Returns once every channel has its objects.
+		 */
+		void evaluate(const ::Camera::ChannelPtrVector &channels);
+		
+	private:
+		friend class ChannelWorker;
+		
+		std::vector<ChannelWorker *> m_workers;
+		
+		Mutex m_mutex;
+		Condition m_wake;
+		Condition m_done;
+		std::vector<ChannelWorker *>::size_type m_remaining;
+		bool m_stop;
+	};
+}
+
+#endif
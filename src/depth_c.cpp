@@ -21,6 +21,10 @@
 #include "kovan/depth_exception.hpp"
 #include "kovan/depth_driver.hpp"
 #include "kovan/colinear_segmenter.hpp"
+#include "kovan/depth_segmenter.hpp"
+#include "kovan/ground_plane.hpp"
+#include "kovan/occupancy_grid.hpp"
+#include "kovan/depth_filter.hpp"
 #include "kovan/depth.h"
 #include "kovan/general.h"
 #include "kovan/util.h"
@@ -39,104 +43,60 @@ namespace depth
   {
     static DepthImage *_depth_image = 0;
     static uint16_t _orientation = 0;
-    static int scanRow = -1;
-    static std::vector<Segment> segments;
+    // A segment of a scanline with everything the accessors need, computed
+    // once by depth_scanlines_update
+    struct ScanlineObject
+    {
+      Segment segment;
+      point3 start;
+      point3 end;
+      point3 nearest;
+      point3 farthest;
+      point3 center;
+    };
+    
+    struct Scanline
+    {
+      int row;
+      std::vector<ScanlineObject> objects;
+    };
+    
+    static std::vector<Scanline> scanlines;
+    static int scanIndex = -1;
+    static std::vector<uint16_t> scanDepths;
+    static std::vector<int> scanData;
+    static std::vector<int32_t> scanX;
+    static std::vector<int32_t> scanY;
+    static std::vector<int32_t> scanZ;
     static SortMethod sortMethod = SORT_NEAREST;
+    static DepthSegmenter segmenter;
+    static std::vector<DepthObject> objects;
+    static bool objectsValid = false;
+    static GroundPlane groundPlane;
+    static bool groundRemoval = false;
+    static std::vector<uint8_t> scanGround;
+    static OccupancyGrid grid;
+    static DepthFilter filter;
   }
 }
 
 using namespace depth;
 using namespace depth::Private;
 
-int findMin(const Segment &seg)
+static bool nearestFirst(const ScanlineObject &a, const ScanlineObject &b)
 {
-  if(scanRow < 0) return -1;
-  int min = -1;
-  int minVal = 0xFFFFFFF;
-  for(int i = seg.start; i < seg.end; ++i) {
-    if(_depth_image->depthAt(scanRow, i) < minVal) {
-      min = i;
-      minVal = _depth_image->depthAt(scanRow, i);
-    }
-  }
-  return min;
+  return a.nearest.z < b.nearest.z;
 }
 
-int findMax(const Segment &seg)
+static bool centerFirst(const ScanlineObject &a, const ScanlineObject &b)
 {
-  if(scanRow < 0) return -1;
-  int max = -1;
-  int maxVal = 0;
-  for(int i = seg.start; i < seg.end; ++i) {
-    if(_depth_image->depthAt(scanRow, i) > maxVal) {
-      max = i;
-      maxVal = _depth_image->depthAt(scanRow, i);
-    }
-  }
-  return max;
+  return a.center.z < b.center.z;
 }
 
-
-class SegmentNearestFunctor
-{
-public:
-  SegmentNearestFunctor(int row, depth::DepthImage *const image)
-    : _row(row)
-    , _image(image)
-  {
-    
-  }
-  
-  bool operator()(const Segment &a, const Segment &b) const
-  {
-    return _image->pointAt(_row, findMin(a)).z() < _image->pointAt(_row, findMin(b)).z();
-  }
-private:
-
-  const int _row;
-  depth::DepthImage *const _image;
-};
-
-class SegmentFarthestFunctor
-{
-public:
-  SegmentFarthestFunctor(int row, depth::DepthImage *const image)
-    : _row(row)
-    , _image(image)
-  {
-    
-  }
-  
-  bool operator()(const Segment &a, const Segment &b) const
-  {
-    return _image->pointAt(_row, findMax(a)).z() < _image->pointAt(_row, findMax(b)).z();
-  }
-private:
-
-  const int _row;
-  depth::DepthImage *const _image;
-};
-
-class SegmentCenterFunctor
+static bool farthestFirst(const ScanlineObject &a, const ScanlineObject &b)
 {
-public:
-  SegmentCenterFunctor(int row, depth::DepthImage *const image)
-    : _row(row)
-    , _image(image)
-  {
-    
-  }
-  
-  bool operator()(const Segment &a, const Segment &b) const
-  {
-    return _image->pointAt(_row, (a.start + a.end) >> 1).z()
-      < _image->pointAt(_row, (b.start + b.end) >> 1).z();
-  }
-private:
-
-  const int _row;
-  depth::DepthImage *const _image;
-};
+  return a.farthest.z < b.farthest.z;
+}
 
 #define catchAllAndReturn(return_value) \
   catch(std::exception& e) { std::cerr << e.what() << std::endl; } \
@@ -202,16 +162,35 @@ int get_depth_orientation()
 int depth_update()
 {
   try {
-    segments.clear();
-    scanRow = -1;
+    scanlines.clear();
+    scanIndex = -1;
+    objects.clear();
+    objectsValid = false;
     _depth_image = DepthDriver::instance().depthImage();
     if(!_depth_image) return 0;
     _depth_image->setOrientation(_orientation);
+    if(groundRemoval) groundPlane.update(*_depth_image);
     return 1;
   }
   catchAllAndReturn(0);
 }
 
+int get_depth_frame_number()
+{
+  try {
+    return _depth_image ? _depth_image->frameNumber() : 0;
+  }
+  catchAllAndReturn(0);
+}
+
+double get_depth_frame_timestamp()
+{
+  try {
+    return _depth_image ? _depth_image->timestamp() : 0.0;
+  }
+  catchAllAndReturn(0.0);
+}
+
 int get_depth_image_height()
 {
   try {
@@ -262,93 +241,172 @@ int get_depth_world_point_z(int row, int column)
   return get_depth_world_point(row, column).z;
 }
 
+int get_depth_world_points(int row, int rows, point3 *points)
+{
+  try {
+    if(!_depth_image) throw Exception("Depth image is not valid");
+    if(!points || row < 0 || rows <= 0 || row + rows > (int)_depth_image->height()) {
+      throw Exception("Invalid row range");
+    }
+    
+    const uint32_t size = _depth_image->width() * rows;
+    static std::vector<int32_t> x;
+    static std::vector<int32_t> y;
+    static std::vector<int32_t> z;
+    x.resize(size);
+    y.resize(size);
+    z.resize(size);
+    _depth_image->points(&x[0], &y[0], &z[0], row, rows);
+    for(uint32_t i = 0; i < size; ++i) points[i] = create_point3(x[i], y[i], z[i]);
+    return 1;
+  }
+  catchAllAndReturn(0);
+}
+
 
 
-int depth_scanline_update(int row)
+static point3 scanline_point(const unsigned column)
 {
-  if(row < 0 || row >= get_depth_image_height()) {
-    std::cerr << "depth_scanline_update needs a valid row" << std::endl;
-    return 0;
-  }
-  scanRow = row;
-  int *const data = new int[get_depth_image_width()];
-  for(unsigned i = 0; i < get_depth_image_width(); ++i) {
-    data[i] = get_depth_value(scanRow, i);
+  return create_point3(scanX[column], scanY[column], scanZ[column]);
+}
+
+static void scanline_segment(Scanline &line)
+{
+  const unsigned width = _depth_image->width();
+  scanDepths.resize(width);
+  scanData.resize(width);
+  _depth_image->row(line.row, &scanDepths[0]);
+  int *const data = &scanData[0];
+  for(unsigned i = 0; i < width; ++i) data[i] = scanDepths[i];
+  
+  // Ground pixels split segments like pixels without a depth value
+  if(groundRemoval && groundPlane.isValid()) {
+    scanGround.resize(width);
+    groundPlane.mask(*_depth_image, &scanGround[0], line.row, 1);
+    for(unsigned i = 0; i < width; ++i) if(scanGround[i]) data[i] = 0;
   }
   
+  scanX.resize(width);
+  scanY.resize(width);
+  scanZ.resize(width);
+  _depth_image->points(&scanX[0], &scanY[0], &scanZ[0], line.row, 1);
+  
   using namespace std;
   ColinearSegmenter segmenter(5);
-  vector<Segment> pre = coalesceSegments(segmenter.findSegments(data, get_depth_image_width()));
-  segments.clear();
+  vector<Segment> pre = coalesceSegments(segmenter.findSegments(data, width));
+  line.objects.clear();
   vector<Segment>::const_iterator it = pre.begin();
   for(; it != pre.end(); ++it) {
     if(data[(*it).start] == 0 || data[(*it).end] == 0) continue;
     if((*it).end - (*it).start < 10) continue;
-    segments.push_back(*it);
+    
+    unsigned nearest = (*it).start;
+    unsigned farthest = (*it).start;
+    for(unsigned i = (*it).start + 1; i < (*it).end; ++i) {
+      if(scanDepths[i] < scanDepths[nearest]) nearest = i;
+      if(scanDepths[i] > scanDepths[farthest]) farthest = i;
+    }
+    
+    ScanlineObject object;
+    object.segment = *it;
+    object.start = scanline_point((*it).start);
+    object.end = scanline_point((*it).end);
+    object.nearest = scanline_point(nearest);
+    object.farthest = scanline_point(farthest);
+    object.center = scanline_point(((*it).start + (*it).end) >> 1);
+    line.objects.push_back(object);
   }
-
+  
   if(sortMethod == SORT_NEAREST) {
-    std::sort(segments.begin(), segments.end(), SegmentNearestFunctor(scanRow, _depth_image));
+    std::sort(line.objects.begin(), line.objects.end(), nearestFirst);
   } else if(sortMethod == SORT_CENTER) {
-    std::sort(segments.begin(), segments.end(), SegmentCenterFunctor(scanRow, _depth_image));
+    std::sort(line.objects.begin(), line.objects.end(), centerFirst);
   } else if(sortMethod == SORT_FARTHEST) {
-    std::sort(segments.begin(), segments.end(), SegmentFarthestFunctor(scanRow, _depth_image));
+    std::sort(line.objects.begin(), line.objects.end(), farthestFirst);
+  }
+}
+
+int depth_scanlines_update(const int *rows, int count)
+{
+  if(!rows || count <= 0) {
+    std::cerr << "depth_scanlines_update needs at least one row" << std::endl;
+    return 0;
+  }
+  const int height = get_depth_image_height();
+  for(int i = 0; i < count; ++i) {
+    if(rows[i] < 0 || rows[i] >= height) {
+      std::cerr << "depth_scanlines_update needs valid rows" << std::endl;
+      return 0;
+    }
   }
   
-  delete[] data;
+  scanlines.resize(count);
+  for(int i = 0; i < count; ++i) {
+    scanlines[i].row = rows[i];
+    scanline_segment(scanlines[i]);
+  }
+  scanIndex = 0;
   return 1;
 }
 
-int get_depth_scanline_object_count()
+int depth_scanline_select(int row)
 {
-  if(!_depth_image) return -1;
-  if(scanRow < 0) return -1;
-  return segments.size();
+  for(unsigned i = 0; i < scanlines.size(); ++i) {
+    if(scanlines[i].row != row) continue;
+    scanIndex = i;
+    return 1;
+  }
+  std::cerr << "Row " << row << " was not segmented by depth_scanlines_update" << std::endl;
+  return 0;
 }
 
-point3 get_depth_scanline_object_center(int object_num)
+int depth_scanline_update(int row)
 {
-  if(!_depth_image) return create_point3(-1, -1, -1);
-  if(scanRow < 0) {
-    std::cerr << "Must call depth_scanline_update first" << std::endl;
-    return create_point3(-1, -1, -1);
-  }
-  if(object_num < 0 || object_num >= segments.size()) {
-    std::cerr << "object_num " << object_num << " is invalid!" << std::endl;
-    return create_point3(-1, -1, -1);
+  if(row < 0 || row >= get_depth_image_height()) {
+    std::cerr << "depth_scanline_update needs a valid row" << std::endl;
+    return 0;
   }
-  return get_depth_world_point(scanRow,
-    (segments[object_num].start + segments[object_num].end) >> 1);
+  return depth_scanlines_update(&row, 1);
 }
 
-point3 get_depth_scanline_object_nearest(int object_num)
+static const ScanlineObject *scanline_object(int object_num)
 {
-  if(!_depth_image) return create_point3(-1, -1, -1);
-  if(scanRow < 0) {
+  if(!_depth_image) return 0;
+  if(scanIndex < 0) {
     std::cerr << "Must call depth_scanline_update first" << std::endl;
-    return create_point3(-1, -1, -1);
+    return 0;
   }
-  if(object_num < 0 || object_num >= segments.size()) {
+  const std::vector<ScanlineObject> &objects = scanlines[scanIndex].objects;
+  if(object_num < 0 || object_num >= (int)objects.size()) {
     std::cerr << "object_num " << object_num << " is invalid!" << std::endl;
-    return create_point3(-1, -1, -1);
+    return 0;
   }
-  return get_depth_world_point(scanRow,
-    findMin(segments[object_num]));
+  return &objects[object_num];
+}
+
+int get_depth_scanline_object_count()
+{
+  if(!_depth_image) return -1;
+  if(scanIndex < 0) return -1;
+  return scanlines[scanIndex].objects.size();
+}
+
+point3 get_depth_scanline_object_center(int object_num)
+{
+  const ScanlineObject *const object = scanline_object(object_num);
+  return object ? object->center : create_point3(-1, -1, -1);
+}
+
+point3 get_depth_scanline_object_nearest(int object_num)
+{
+  const ScanlineObject *const object = scanline_object(object_num);
+  return object ? object->nearest : create_point3(-1, -1, -1);
 }
 
 point3 get_depth_scanline_object_farthest(int object_num)
 {
-  if(!_depth_image) return create_point3(-1, -1, -1);
-  if(scanRow < 0) {
-    std::cerr << "Must call depth_scanline_update first" << std::endl;
-    return create_point3(-1, -1, -1);
-  }
-  if(object_num < 0 || object_num >= segments.size()) {
-    std::cerr << "object_num " << object_num << " is invalid!" << std::endl;
-    return create_point3(-1, -1, -1);
-  }
-  return get_depth_world_point(scanRow,
-    findMax(segments[object_num]));
+  const ScanlineObject *const object = scanline_object(object_num);
+  return object ? object->farthest : create_point3(-1, -1, -1);
 }
 
 int get_depth_scanline_object_center_x(int object_num)
@@ -398,37 +456,18 @@ int get_depth_scanline_object_farthest_z(int object_num)
 
 int get_depth_scanline_object_size(int object_num)
 {
-  if(scanRow < 0) {
-    std::cerr << "Must call depth_scanline_update first" << std::endl;
-    return -1;
-  }
-  if(object_num < 0 || object_num >= segments.size()) {
-    std::cerr << "object_num " << object_num << " is invalid!" << std::endl;
-    return -1;
-  }
-  
-  const point3 start = get_depth_world_point(scanRow, segments[object_num].start);
-  const point3 end = get_depth_world_point(scanRow, segments[object_num].end);
+  const ScanlineObject *const object = scanline_object(object_num);
+  if(!object) return -1;
   
-  return sqrt(pow(end.x - start.x, 2) + pow(end.z - start.z, 2));
+  return sqrt(pow(object->end.x - object->start.x, 2) + pow(object->end.z - object->start.z, 2));
 }
 
 int get_depth_scanline_object_angle(int object_num)
 {
-  if(scanRow < 0) {
-    std::cerr << "Must call depth_scanline_update first" << std::endl;
-    return -1;
-  }
-  
-  if(object_num < 0 || object_num >= segments.size()) {
-    std::cerr << "object_num " << object_num << " is invalid!" << std::endl;
-    return -1;
-  }
-  
-  const point3 start = get_depth_world_point(scanRow, segments[object_num].start);
-  const point3 end = get_depth_world_point(scanRow, segments[object_num].end);
+  const ScanlineObject *const object = scanline_object(object_num);
+  if(!object) return -1;
   
-  return atan2(end.z - start.z, end.x - start.x) * 180.0 / M_PI;
+  return atan2(object->end.z - object->start.z, object->end.x - object->start.x) * 180.0 / M_PI;
 }
 
 void set_depth_scanline_sorting_method(SortMethod method)
@@ -440,3 +479,130 @@ SortMethod get_depth_scanline_sorting_method()
 {
   return sortMethod;
 }
+
+int set_depth_filter(int enabled)
+{
+  try {
+    DepthDriver &driver = DepthDriver::instance();
+    DepthFilter *const wanted = enabled ? &filter : 0;
+    driver.setFilter(wanted);
+    
+    // Drivers without filter support ignore it
+    return driver.filter() == wanted ? 1 : 0;
+  }
+  catchAllAndReturn(0);
+}
+
+int get_depth_filter()
+{
+  try {
+    return DepthDriver::instance().filter() ? 1 : 0;
+  }
+  catchAllAndReturn(0);
+}
+
+void set_depth_ground_removal(int enabled)
+{
+  groundRemoval = enabled;
+  groundPlane.reset();
+  if(groundRemoval && _depth_image) groundPlane.update(*_depth_image);
+}
+
+int get_depth_ground_removal()
+{
+  return groundRemoval ? 1 : 0;
+}
+
+int get_depth_camera_height()
+{
+  if(!groundRemoval || !groundPlane.isValid()) return -1;
+  return groundPlane.cameraHeight();
+}
+
+int depth_segment_update()
+{
+  try {
+    if(!_depth_image) throw Exception("Depth image is not valid");
+    segmenter.setGroundPlane(groundRemoval ? &groundPlane : 0);
+    segmenter.segment(*_depth_image, objects);
+    objectsValid = true;
+    return 1;
+  }
+  catchAllAndReturn(0);
+}
+
+static const DepthObject *depth_object(int object_num)
+{
+  if(!objectsValid) {
+    std::cerr << "Must call depth_segment_update first" << std::endl;
+    return 0;
+  }
+  if(object_num < 0 || object_num >= (int)objects.size()) {
+    std::cerr << "object_num " << object_num << " is invalid!" << std::endl;
+    return 0;
+  }
+  return &objects[object_num];
+}
+
+int get_depth_object_count()
+{
+  if(!objectsValid) return -1;
+  return objects.size();
+}
+
+int get_depth_object_pixel_count(int object_num)
+{
+  const DepthObject *const object = depth_object(object_num);
+  return object ? object->pixels : -1;
+}
+
+point3 get_depth_object_centroid(int object_num)
+{
+  const DepthObject *const object = depth_object(object_num);
+  return object ? object->centroid.toCPoint3() : create_point3(-1, -1, -1);
+}
+
+point3 get_depth_object_nearest(int object_num)
+{
+  const DepthObject *const object = depth_object(object_num);
+  return object ? object->nearest.toCPoint3() : create_point3(-1, -1, -1);
+}
+
+point3 get_depth_object_bbox_min(int object_num)
+{
+  const DepthObject *const object = depth_object(object_num);
+  return object ? object->boundingBoxMin.toCPoint3() : create_point3(-1, -1, -1);
+}
+
+point3 get_depth_object_bbox_max(int object_num)
+{
+  const DepthObject *const object = depth_object(object_num);
+  return object ? object->boundingBoxMax.toCPoint3() : create_point3(-1, -1, -1);
+}
+
+int depth_grid_update()
+{
+  try {
+    if(!_depth_image) throw Exception("Depth image is not valid");
+    
+    // Heights are only meaningful above the ground, so the plane is fitted
+    // here if depth_update didn't already
+    if(!groundRemoval) groundPlane.update(*_depth_image);
+    if(!groundPlane.isValid()) throw Exception("No ground plane found");
+    grid.setGroundPlane(&groundPlane);
+    grid.update(*_depth_image);
+    return 1;
+  }
+  catchAllAndReturn(0);
+}
+
+int get_depth_grid_nearest_obstacle(int from_angle, int to_angle)
+{
+  return grid.nearestObstacle(from_angle, to_angle);
+}
+
+int get_depth_grid_path_free(int angle, int length, int width)
+{
+  if(length < 0 || width < 0) return 0;
+  return grid.isPathFree(angle, length, width) ? 1 : 0;
+}
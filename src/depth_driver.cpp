@@ -23,10 +23,26 @@
 
 using namespace depth;
 
+static DepthDriver *s_instance = 0;
+
 DepthDriver& DepthDriver::instance()
 {
-  return XtionDepthDriver::instance(); // currently we have only one driver
-                                       //  --> no need for more complex things
+  if(s_instance) return *s_instance;
+  return XtionDepthDriver::instance();
+}
+
+void DepthDriver::setInstance(DepthDriver *const driver)
+{
+  s_instance = driver;
+}
+
+void DepthDriver::setFilter(DepthFilter *const)
+{
+}
+
+DepthFilter *DepthDriver::filter() const
+{
+  return 0;
 }
 
 
@@ -0,0 +1,163 @@
+#include <kovan/depth_filter.hpp>
+
+#include <algorithm>
+
+using namespace depth;
+
+// Fixed point scale of the temporal weight
+#define WEIGHT_ONE 256
+
+DepthFilter::DepthFilter()
+  : _holeFill(true)
+  , _maxHoleSize(8)
+  , _maxStepRatio(0.04f)
+  , _weight(WEIGHT_ONE / 2)
+{
+}
+
+void DepthFilter::setHoleFill(const bool holeFill)
+{
+  _holeFill = holeFill;
+}
+
+bool DepthFilter::holeFill() const
+{
+  return _holeFill;
+}
+
+void DepthFilter::setMaxHoleSize(const uint16_t pixels)
+{
+  _maxHoleSize = pixels;
+}
+
+uint16_t DepthFilter::maxHoleSize() const
+{
+  return _maxHoleSize;
+}
+
+void DepthFilter::setMaxStepRatio(const float ratio)
+{
+  _maxStepRatio = ratio;
+}
+
+float DepthFilter::maxStepRatio() const
+{
+  return _maxStepRatio;
+}
+
+void DepthFilter::setSmoothing(const float weight)
+{
+  _weight = std::max(0.0f, std::min(1.0f, weight)) * WEIGHT_ONE;
+}
+
+float DepthFilter::smoothing() const
+{
+  return (float)_weight / WEIGHT_ONE;
+}
+
+void DepthFilter::reset()
+{
+  _previous.clear();
+  _held.clear();
+}
+
+void DepthFilter::apply(uint16_t *const data, const uint32_t width, const uint32_t height)
+{
+  if(!data || !width || !height) return;
+  
+  if(_holeFill && _maxHoleSize) {
+    fillRows(data, width, height);
+    fillColumns(data, width, height);
+  }
+  
+  if(_weight < WEIGHT_ONE) smooth(data, width * height);
+}
+
+uint16_t DepthFilter::edgeFill(const uint16_t a, const uint16_t b) const
+{
+  // Across an edge the hole belongs to the background
+  const uint16_t nearer = std::min(a, b);
+  const uint16_t farther = std::max(a, b);
+  if(farther - nearer > nearer * _maxStepRatio) return farther;
+  return 0;
+}
+
+void DepthFilter::fillRows(uint16_t *const data, const uint32_t width, const uint32_t height) const
+{
+  for(uint32_t r = 0; r < height; ++r) {
+    uint16_t *const row = data + r * width;
+    int32_t last = -1;
+    for(uint32_t c = 0; c < width; ++c) {
+      if(!row[c]) continue;
+      
+      const int32_t gap = c - last - 1;
+      if(last >= 0 && gap > 0 && gap <= _maxHoleSize) {
+        const int32_t a = row[last];
+        const int32_t b = row[c];
+        const uint16_t edge = edgeFill(a, b);
+        for(int32_t i = 1; i <= gap; ++i) {
+          row[last + i] = edge ? edge : a + (b - a) * i / (gap + 1);
+        }
+      }
+      last = c;
+    }
+  }
+}
+
+void DepthFilter::fillColumns(uint16_t *const data, const uint32_t width, const uint32_t height)
+{
+  // Walk the rows in memory order, tracking every column's last depth
+  _lastRows.assign(width, -1);
+  int32_t *const lastRows = &_lastRows[0];
+  for(uint32_t r = 0; r < height; ++r) {
+    uint16_t *const row = data + r * width;
+    for(uint32_t c = 0; c < width; ++c) {
+      if(!row[c]) continue;
+      
+      const int32_t last = lastRows[c];
+      const int32_t gap = r - last - 1;
+      if(last >= 0 && gap > 0 && gap <= _maxHoleSize) {
+        const int32_t a = data[last * width + c];
+        const int32_t b = row[c];
+        const uint16_t edge = edgeFill(a, b);
+        for(int32_t i = 1; i <= gap; ++i) {
+          data[(last + i) * width + c] = edge ? edge : a + (b - a) * i / (gap + 1);
+        }
+      }
+      lastRows[c] = r;
+    }
+  }
+}
+
+void DepthFilter::smooth(uint16_t *const data, const uint32_t size)
+{
+  if(_previous.size() != size) {
+    _previous.assign(data, data + size);
+    _held.assign(size, 0);
+    return;
+  }
+  
+  uint16_t *const previous = &_previous[0];
+  uint8_t *const held = &_held[0];
+  const uint32_t weight = _weight;
+  const float ratio = _maxStepRatio;
+  for(uint32_t i = 0; i < size; ++i) {
+    const uint32_t d = data[i];
+    const uint32_t p = previous[i];
+    
+    if(!d) {
+      // Bridge a single dropped frame
+      if(p && !held[i]) {
+        data[i] = p;
+        held[i] = 1;
+      } else previous[i] = 0;
+      continue;
+    }
+    held[i] = 0;
+    
+    const uint32_t step = d > p ? d - p : p - d;
+    if(!p || step > p * ratio) previous[i] = d;
+    else previous[i] = (p * (WEIGHT_ONE - weight) + d * weight + WEIGHT_ONE / 2) / WEIGHT_ONE;
+    data[i] = previous[i];
+  }
+}
@@ -1,6 +1,120 @@
 #include <kovan/depth_image.hpp>
+#include <kovan/depth_segmenter.hpp>
+#include <cstring>
 
 depth::DepthImage::~DepthImage()
 {
   
-}
\ No newline at end of file
+}
+
+void depth::DepthImage::row(const uint32_t row, uint16_t *const data) const
+{
+  const uint32_t w = width();
+  const uint16_t *const raw = rawData();
+  if(!raw) {
+    for(uint32_t c = 0; c < w; ++c) data[c] = depthAt(row, c);
+    return;
+  }
+  
+  if(orientation() == 0) {
+    const uint16_t *const src = raw + row * w + w - 1;
+    for(uint32_t c = 0; c < w; ++c) data[c] = *(src - c);
+  } else memcpy(data, raw + (height() - 1 - row) * w, w * sizeof(uint16_t));
+}
+
+void depth::DepthImage::column(const uint32_t column, uint16_t *const data) const
+{
+  const uint32_t w = width();
+  const uint32_t h = height();
+  const uint16_t *const raw = rawData();
+  if(!raw) {
+    for(uint32_t r = 0; r < h; ++r) data[r] = depthAt(r, column);
+    return;
+  }
+  
+  if(orientation() == 0) {
+    const uint16_t *src = raw + w - 1 - column;
+    for(uint32_t r = 0; r < h; ++r, src += w) data[r] = *src;
+  } else {
+    const uint16_t *src = raw + (h - 1) * w + column;
+    for(uint32_t r = 0; r < h; ++r, src -= w) data[r] = *src;
+  }
+}
+
+void depth::DepthImage::subsample(uint16_t *const data, const uint32_t rowStep,
+  const uint32_t columnStep) const
+{
+  if(!rowStep || !columnStep) return;
+  
+  const uint32_t w = width();
+  const uint32_t h = height();
+  const uint16_t *const raw = rawData();
+  const bool mirrored = orientation() == 0;
+  uint16_t *out = data;
+  for(uint32_t r = 0; r < h; r += rowStep) {
+    if(!raw) {
+      for(uint32_t c = 0; c < w; c += columnStep) *out++ = depthAt(r, c);
+      continue;
+    }
+    
+    const uint16_t *const src = raw + (mirrored ? r : h - 1 - r) * w;
+    if(mirrored) {
+      for(uint32_t c = 0; c < w; c += columnStep) *out++ = src[w - 1 - c];
+    } else {
+      for(uint32_t c = 0; c < w; c += columnStep) *out++ = src[c];
+    }
+  }
+}
+
+void depth::DepthImage::segment(std::vector<DepthObject> &objects) const
+{
+  DepthSegmenter segmenter;
+  segmenter.segment(*this, objects);
+}
+
+const float *depth::DepthImage::columnRays() const
+{
+  return 0;
+}
+
+const float *depth::DepthImage::rowRays() const
+{
+  return 0;
+}
+
+const uint16_t *depth::DepthImage::rawData() const
+{
+  return 0;
+}
+
+uint32_t depth::DepthImage::frameNumber() const
+{
+  return 0;
+}
+
+double depth::DepthImage::timestamp() const
+{
+  return 0.0;
+}
+
+void depth::DepthImage::points(Point3<int32_t> *const points, const uint32_t row, const uint32_t rows) const
+{
+  const uint32_t w = width();
+  for(uint32_t r = 0; r < rows; ++r) {
+    for(uint32_t c = 0; c < w; ++c) points[r * w + c] = pointAt(row + r, c);
+  }
+}
+
+void depth::DepthImage::points(int32_t *const x, int32_t *const y, int32_t *const z,
+  const uint32_t row, const uint32_t rows) const
+{
+  const uint32_t w = width();
+  for(uint32_t r = 0; r < rows; ++r) {
+    for(uint32_t c = 0; c < w; ++c) {
+      const Point3<int32_t> p = pointAt(row + r, c);
+      x[r * w + c] = p.x();
+      y[r * w + c] = p.y();
+      z[r * w + c] = p.z();
+    }
+  }
+}
@@ -0,0 +1,209 @@
+#include <kovan/depth_segmenter.hpp>
+#include <kovan/depth_image.hpp>
+#include <kovan/ground_plane.hpp>
+
+#include <algorithm>
+#include <limits>
+
+using namespace depth;
+
+DepthObject::DepthObject()
+  : pixels(0)
+  , centroid(0, 0, 0)
+  , boundingBoxMin(0, 0, 0)
+  , boundingBoxMax(0, 0, 0)
+  , nearest(0, 0, 0)
+  , top(0)
+  , left(0)
+  , bottom(0)
+  , right(0)
+{
+}
+
+static bool nearestFirst(const DepthObject &a, const DepthObject &b)
+{
+  return a.nearest.z() < b.nearest.z();
+}
+
+DepthSegmenter::DepthSegmenter()
+  : _maxStepRatio(0.04f)
+  , _minPixels(50)
+  , _groundPlane(0)
+{
+}
+
+void DepthSegmenter::setMaxStepRatio(const float ratio)
+{
+  _maxStepRatio = ratio;
+}
+
+float DepthSegmenter::maxStepRatio() const
+{
+  return _maxStepRatio;
+}
+
+void DepthSegmenter::setMinPixels(const uint32_t pixels)
+{
+  _minPixels = pixels;
+}
+
+uint32_t DepthSegmenter::minPixels() const
+{
+  return _minPixels;
+}
+
+void DepthSegmenter::setGroundPlane(const GroundPlane *const groundPlane)
+{
+  _groundPlane = groundPlane;
+}
+
+const GroundPlane *DepthSegmenter::groundPlane() const
+{
+  return _groundPlane;
+}
+
+void DepthSegmenter::segment(const DepthImage &image, std::vector<DepthObject> &objects)
+{
+  objects.clear();
+
+  const uint32_t w = image.width();
+  const uint32_t h = image.height();
+  const uint32_t size = w * h;
+  if(!size) return;
+
+  _depths.resize(size);
+  for(uint32_t r = 0; r < h; ++r) image.row(r, &_depths[r * w]);
+  
+  _x.resize(size);
+  _y.resize(size);
+  _z.resize(size);
+  image.points(&_x[0], &_y[0], &_z[0], 0, h);
+  
+  // Ground pixels are treated like pixels without a depth value
+  if(_groundPlane && _groundPlane->isValid()) {
+    for(uint32_t i = 0; i < size; ++i) {
+      if(_depths[i] && _groundPlane->isGround(Point3<int32_t>(_x[i], _y[i], _z[i]))) _depths[i] = 0;
+    }
+  }
+
+  // First pass: provisional labels, merging equivalent ones. 0 is no label.
+  _labels.assign(size, 0);
+  _parents.clear();
+  _parents.push_back(0);
+  for(uint32_t r = 0; r < h; ++r) {
+    for(uint32_t c = 0; c < w; ++c) {
+      const uint32_t i = r * w + c;
+      const uint16_t d = _depths[i];
+      if(!d) continue;
+
+      const uint32_t left = (c > 0 && _labels[i - 1] && connected(d, _depths[i - 1])) ? _labels[i - 1] : 0;
+      const uint32_t up = (r > 0 && _labels[i - w] && connected(d, _depths[i - w])) ? _labels[i - w] : 0;
+
+      if(left && up) _labels[i] = unite(left, up);
+      else if(left || up) _labels[i] = left ? left : up;
+      else {
+        _labels[i] = _parents.size();
+        _parents.push_back(_parents.size());
+      }
+    }
+  }
+
+  // Give every component a compact index. Roots are the smallest label of
+  // their component, so they are numbered before any of their children.
+  _components.resize(_parents.size());
+  uint32_t components = 0;
+  for(uint32_t l = 1; l < _parents.size(); ++l) {
+    const uint32_t root = find(l);
+    _components[l] = root == l ? components++ : _components[root];
+  }
+  if(!components) return;
+
+  Stats empty;
+  empty.pixels = 0;
+  empty.sumX = empty.sumY = empty.sumZ = 0;
+  empty.minX = empty.minY = empty.minZ = std::numeric_limits<int32_t>::max();
+  empty.maxX = empty.maxY = empty.maxZ = std::numeric_limits<int32_t>::min();
+  empty.nearest = 0;
+  empty.top = empty.left = std::numeric_limits<uint32_t>::max();
+  empty.bottom = empty.right = 0;
+  _stats.assign(components, empty);
+
+  // Second pass: accumulate the statistics of every component
+  for(uint32_t r = 0; r < h; ++r) {
+    for(uint32_t c = 0; c < w; ++c) {
+      const uint32_t i = r * w + c;
+      if(!_labels[i]) continue;
+
+      Stats &s = _stats[_components[_labels[i]]];
+      const int32_t x = _x[i];
+      const int32_t y = _y[i];
+      const int32_t z = _z[i];
+      if(!s.pixels || z < _z[s.nearest]) s.nearest = i;
+      ++s.pixels;
+      s.sumX += x;
+      s.sumY += y;
+      s.sumZ += z;
+      s.minX = std::min(s.minX, x);
+      s.minY = std::min(s.minY, y);
+      s.minZ = std::min(s.minZ, z);
+      s.maxX = std::max(s.maxX, x);
+      s.maxY = std::max(s.maxY, y);
+      s.maxZ = std::max(s.maxZ, z);
+      s.top = std::min(s.top, r);
+      s.left = std::min(s.left, c);
+      s.bottom = std::max(s.bottom, r);
+      s.right = std::max(s.right, c);
+    }
+  }
+
+  std::vector<Stats>::const_iterator it = _stats.begin();
+  for(; it != _stats.end(); ++it) {
+    const Stats &s = *it;
+    if(!s.pixels || s.pixels < _minPixels) continue;
+
+    DepthObject object;
+    object.pixels = s.pixels;
+    object.centroid = Point3<int32_t>(s.sumX / s.pixels, s.sumY / s.pixels, s.sumZ / s.pixels);
+    object.boundingBoxMin = Point3<int32_t>(s.minX, s.minY, s.minZ);
+    object.boundingBoxMax = Point3<int32_t>(s.maxX, s.maxY, s.maxZ);
+    object.nearest = Point3<int32_t>(_x[s.nearest], _y[s.nearest], _z[s.nearest]);
+    object.top = s.top;
+    object.left = s.left;
+    object.bottom = s.bottom;
+    object.right = s.right;
+    objects.push_back(object);
+  }
+
+  std::sort(objects.begin(), objects.end(), nearestFirst);
+}
+
+uint32_t DepthSegmenter::find(uint32_t label)
+{
+  while(_parents[label] != label) {
+    // Path halving
+    _parents[label] = _parents[_parents[label]];
+    label = _parents[label];
+  }
+  return label;
+}
+
+uint32_t DepthSegmenter::unite(const uint32_t a, const uint32_t b)
+{
+  const uint32_t ra = find(a);
+  const uint32_t rb = find(b);
+  if(ra == rb) return ra;
+
+  // Keep the smaller label as the root
+  if(ra < rb) {
+    _parents[rb] = ra;
+    return ra;
+  }
+  _parents[ra] = rb;
+  return rb;
+}
+
+bool DepthSegmenter::connected(const uint16_t a, const uint16_t b) const
+{
+  const uint16_t nearer = std::min(a, b);
+  return (uint16_t)(std::max(a, b) - nearer) <= nearer * _maxStepRatio;
+}
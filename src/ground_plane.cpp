@@ -0,0 +1,300 @@
+#include <kovan/ground_plane.hpp>
+#include <kovan/depth_image.hpp>
+
+#include <cmath>
+#include <limits>
+
+// Number of candidate planes tried when searching from scratch
+#define RANSAC_ITERATIONS 64
+
+// The normal may be tilted at most 60 degrees from the image's vertical
+// axis, so walls are never mistaken for the ground
+#define MIN_NORMAL_Y 0.5f
+
+using namespace depth;
+
+// Points the normal away from the ground, towards the camera at the origin
+static bool orient(float &nx, float &ny, float &nz, float &d)
+{
+  if(d < 0.0f) {
+    nx = -nx;
+    ny = -ny;
+    nz = -nz;
+    d = -d;
+  }
+  return d > 0.0f && std::fabs(ny) >= MIN_NORMAL_Y;
+}
+
+GroundPlane::GroundPlane()
+  : _sampleStep(4)
+  , _inlierDistance(20)
+  , _groundHeight(30)
+  , _minInlierRatio(0.2f)
+  , _valid(false)
+  , _nx(0.0f)
+  , _ny(0.0f)
+  , _nz(0.0f)
+  , _d(0.0f)
+  , _seed(1)
+{
+}
+
+void GroundPlane::setSampleStep(const uint32_t step)
+{
+  _sampleStep = step ? step : 1;
+}
+
+uint32_t GroundPlane::sampleStep() const
+{
+  return _sampleStep;
+}
+
+void GroundPlane::setInlierDistance(const uint16_t distance)
+{
+  _inlierDistance = distance;
+}
+
+uint16_t GroundPlane::inlierDistance() const
+{
+  return _inlierDistance;
+}
+
+void GroundPlane::setGroundHeight(const uint16_t height)
+{
+  _groundHeight = height;
+}
+
+uint16_t GroundPlane::groundHeight() const
+{
+  return _groundHeight;
+}
+
+void GroundPlane::setMinInlierRatio(const float ratio)
+{
+  _minInlierRatio = ratio;
+}
+
+float GroundPlane::minInlierRatio() const
+{
+  return _minInlierRatio;
+}
+
+bool GroundPlane::update(const DepthImage &image)
+{
+  const uint32_t w = image.width();
+  const uint32_t h = image.height();
+  
+  _sx.clear();
+  _sy.clear();
+  _sz.clear();
+  for(uint32_t r = 0; r < h; r += _sampleStep) {
+    convert(image, r, 1);
+    for(uint32_t c = 0; c < w; c += _sampleStep) {
+      if(!_z[c]) continue;
+      _sx.push_back(_x[c]);
+      _sy.push_back(_y[c]);
+      _sz.push_back(_z[c]);
+    }
+  }
+  
+  const uint32_t samples = _sz.size();
+  uint32_t minInliers = samples * _minInlierRatio;
+  if(minInliers < 3) minInliers = 3;
+  if(samples < minInliers) {
+    _valid = false;
+    return false;
+  }
+  
+  if(_valid && refit(minInliers)) return true;
+  _valid = ransac(minInliers);
+  return _valid;
+}
+
+void GroundPlane::reset()
+{
+  _valid = false;
+}
+
+bool GroundPlane::isValid() const
+{
+  return _valid;
+}
+
+Point3<float> GroundPlane::normal() const
+{
+  return Point3<float>(_nx, _ny, _nz);
+}
+
+float GroundPlane::cameraHeight() const
+{
+  return _d;
+}
+
+float GroundPlane::height(const Point3<int32_t> &point) const
+{
+  return _nx * point.x() + _ny * point.y() + _nz * point.z() + _d;
+}
+
+bool GroundPlane::isGround(const Point3<int32_t> &point) const
+{
+  return _valid && height(point) < _groundHeight;
+}
+
+void GroundPlane::heights(const DepthImage &image, int16_t *const heights,
+  const uint32_t row, const uint32_t rows)
+{
+  const uint32_t size = image.width() * rows;
+  const int16_t none = std::numeric_limits<int16_t>::min();
+  if(!_valid) {
+    for(uint32_t i = 0; i < size; ++i) heights[i] = none;
+    return;
+  }
+  
+  convert(image, row, rows);
+  const int16_t highest = std::numeric_limits<int16_t>::max();
+  for(uint32_t i = 0; i < size; ++i) {
+    if(!_z[i]) {
+      heights[i] = none;
+      continue;
+    }
+    const float height = _nx * _x[i] + _ny * _y[i] + _nz * _z[i] + _d;
+    heights[i] = height >= highest ? highest : (height <= none + 1 ? none + 1 : (int16_t)height);
+  }
+}
+
+void GroundPlane::mask(const DepthImage &image, uint8_t *const mask,
+  const uint32_t row, const uint32_t rows)
+{
+  const uint32_t size = image.width() * rows;
+  if(!_valid) {
+    for(uint32_t i = 0; i < size; ++i) mask[i] = 0;
+    return;
+  }
+  
+  convert(image, row, rows);
+  const float groundHeight = _groundHeight;
+  for(uint32_t i = 0; i < size; ++i) {
+    mask[i] = _z[i] && _nx * _x[i] + _ny * _y[i] + _nz * _z[i] + _d < groundHeight;
+  }
+}
+
+uint32_t GroundPlane::inliers(const float nx, const float ny, const float nz, const float d) const
+{
+  const float distance = _inlierDistance;
+  const uint32_t samples = _sz.size();
+  uint32_t ret = 0;
+  for(uint32_t i = 0; i < samples; ++i) {
+    ret += std::fabs(nx * _sx[i] + ny * _sy[i] + nz * _sz[i] + d) <= distance;
+  }
+  return ret;
+}
+
+bool GroundPlane::ransac(const uint32_t minInliers)
+{
+  const uint32_t samples = _sz.size();
+  uint32_t best = 0;
+  
+  for(uint32_t i = 0; i < RANSAC_ITERATIONS; ++i) {
+    const uint32_t a = random() % samples;
+    const uint32_t b = random() % samples;
+    const uint32_t c = random() % samples;
+    if(a == b || a == c || b == c) continue;
+    
+    const float ux = _sx[b] - _sx[a], uy = _sy[b] - _sy[a], uz = _sz[b] - _sz[a];
+    const float vx = _sx[c] - _sx[a], vy = _sy[c] - _sy[a], vz = _sz[c] - _sz[a];
+    float nx = uy * vz - uz * vy;
+    float ny = uz * vx - ux * vz;
+    float nz = ux * vy - uy * vx;
+    const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+    if(length < 1.0f) continue;
+    nx /= length;
+    ny /= length;
+    nz /= length;
+    float d = -(nx * _sx[a] + ny * _sy[a] + nz * _sz[a]);
+    if(!orient(nx, ny, nz, d)) continue;
+    
+    const uint32_t count = inliers(nx, ny, nz, d);
+    if(count <= best) continue;
+    best = count;
+    _nx = nx;
+    _ny = ny;
+    _nz = nz;
+    _d = d;
+  }
+  
+  if(best < minInliers) return false;
+  
+  // Polish the best candidate, but keep it if the refit goes astray
+  const float nx = _nx, ny = _ny, nz = _nz, d = _d;
+  if(!refit(minInliers)) {
+    _nx = nx;
+    _ny = ny;
+    _nz = nz;
+    _d = d;
+  }
+  return true;
+}
+
+bool GroundPlane::refit(const uint32_t minInliers)
+{
+  const float distance = _inlierDistance;
+  const uint32_t samples = _sz.size();
+  
+  // Least squares fit of y = a * x + b * z + c to the current plane's
+  // inliers. The normal is never far from the y axis, so this stays well
+  // conditioned.
+  double sxx = 0.0, sxz = 0.0, sx = 0.0, szz = 0.0, sz = 0.0;
+  double sxy = 0.0, szy = 0.0, sy = 0.0;
+  uint32_t n = 0;
+  for(uint32_t i = 0; i < samples; ++i) {
+    const double x = _sx[i], y = _sy[i], z = _sz[i];
+    if(std::fabs(_nx * x + _ny * y + _nz * z + _d) > distance) continue;
+    sxx += x * x;
+    sxz += x * z;
+    sx += x;
+    szz += z * z;
+    sz += z;
+    sxy += x * y;
+    szy += z * y;
+    sy += y;
+    ++n;
+  }
+  if(n < minInliers) return false;
+  
+  // Cramer's rule on the normal equations
+  const double det = sxx * (szz * n - sz * sz) - sxz * (sxz * n - sz * sx) + sx * (sxz * sz - szz * sx);
+  if(std::fabs(det) < 1e-9) return false;
+  const double a = (sxy * (szz * n - sz * sz) - sxz * (szy * n - sz * sy) + sx * (szy * sz - szz * sy)) / det;
+  const double b = (sxx * (szy * n - sy * sz) - sxy * (sxz * n - sz * sx) + sx * (sxz * sy - szy * sx)) / det;
+  const double c = (sxx * (szz * sy - sz * szy) - sxz * (sxz * sy - sx * szy) + sxy * (sxz * sz - szz * sx)) / det;
+  
+  // a * x - y + b * z + c = 0
+  const double length = std::sqrt(a * a + 1.0 + b * b);
+  float nx = a / length;
+  float ny = -1.0 / length;
+  float nz = b / length;
+  float d = c / length;
+  if(!orient(nx, ny, nz, d)) return false;
+  if(inliers(nx, ny, nz, d) < minInliers) return false;
+  
+  _nx = nx;
+  _ny = ny;
+  _nz = nz;
+  _d = d;
+  return true;
+}
+
+void GroundPlane::convert(const DepthImage &image, const uint32_t row, const uint32_t rows)
+{
+  const uint32_t size = image.width() * rows;
+  _x.resize(size);
+  _y.resize(size);
+  _z.resize(size);
+  if(size) image.points(&_x[0], &_y[0], &_z[0], row, rows);
+}
+
+uint32_t GroundPlane::random()
+{
+  _seed = _seed * 1103515245 + 12345;
+  return _seed >> 16;
+}
@@ -0,0 +1,261 @@
+#include "kovan/object_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core/core.hpp>
+
+using namespace Camera;
+
+static unsigned toPixel(const double v)
+{
+	return v < 0.0 ? 0 : static_cast<unsigned>(v + 0.5);
+}
+
+// TrackedObject //
+
+TrackedObject::TrackedObject(const unsigned id, const Object &object)
+	: m_id(id),
+	m_x(object.centroid().x()),
+	m_y(object.centroid().y()),
+	m_vx(0.0),
+	m_vy(0.0),
+	m_boundingBox(object.boundingBox()),
+	m_hits(1),
+	m_missed(0)
+{
+}
+
+unsigned TrackedObject::id() const
+{
+	return m_id;
+}
+
+Point2<unsigned> TrackedObject::centroid() const
+{
+	return Point2<unsigned>(toPixel(m_x), toPixel(m_y));
+}
+
+Point2<unsigned> TrackedObject::predictedCentroid() const
+{
+	return Point2<unsigned>(toPixel(m_x + m_vx), toPixel(m_y + m_vy));
+}
+
+const Rect<unsigned> &TrackedObject::boundingBox() const
+{
+	return m_boundingBox;
+}
+
+double TrackedObject::velocityX() const
+{
+	return m_vx;
+}
+
+double TrackedObject::velocityY() const
+{
+	return m_vy;
+}
+
+unsigned TrackedObject::hits() const
+{
+	return m_hits;
+}
+
+unsigned TrackedObject::missed() const
+{
+	return m_missed;
+}
+
+bool TrackedObject::isConfident() const
+{
+	return m_hits >= 3 && m_missed == 0;
+}
+
+void TrackedObject::predict()
+{
+	m_x += m_vx;
+	m_y += m_vy;
+}
+
+void TrackedObject::correct(const Object &object, const double alpha, const double beta)
+{
+	const double rx = object.centroid().x() - m_x;
+	const double ry = object.centroid().y() - m_y;
+	m_x += alpha * rx;
+	m_y += alpha * ry;
+	m_vx += beta * rx;
+	m_vy += beta * ry;
+	m_boundingBox = object.boundingBox();
+	++m_hits;
+	m_missed = 0;
+}
+
+// ObjectTracker //
+
+struct MissedTooLong
+{
+	MissedTooLong(const unsigned maxMissed)
+		: maxMissed(maxMissed)
+	{
+	}
+	
+	bool operator()(const TrackedObject &object) const
+	{
+		return object.missed() > maxMissed;
+	}
+	
+	const unsigned maxMissed;
+};
+
+ObjectTracker::ObjectTracker(Channel *const channel)
+	: m_channel(channel),
+	m_nextId(0),
+	m_maxDistance(40),
+	m_maxMissed(5),
+	m_alpha(0.5),
+	m_beta(0.1),
+	m_seed(false),
+	m_refreshInterval(15),
+	m_sinceRefresh(0)
+{
+}
+
+void ObjectTracker::update()
+{
+	const ObjectVector *const observed = m_channel ? m_channel->objects() : 0;
+	const unsigned numTracks = m_objects.size();
+	const unsigned numObserved = observed ? observed->size() : 0;
+	
+	TrackedObjectVector::iterator it = m_objects.begin();
+	for(; it != m_objects.end(); ++it) it->predict();
+	
+	// Greedily match the closest (prediction, observation) pairs first
+	m_candidates.clear();
+	const double maxDistance2 = (double)m_maxDistance * m_maxDistance;
+	for(unsigned i = 0; i < numTracks; ++i) {
+		const TrackedObject &t = m_objects[i];
+		for(unsigned j = 0; j < numObserved; ++j) {
+			const Point2<unsigned> &c = (*observed)[j].centroid();
+			const double dx = c.x() - t.m_x;
+			const double dy = c.y() - t.m_y;
+			const double d2 = dx * dx + dy * dy;
+			if(d2 > maxDistance2) continue;
+			m_candidates.push_back(std::make_pair((unsigned)d2, std::make_pair(i, j)));
+		}
+	}
+	std::sort(m_candidates.begin(), m_candidates.end());
+	
+	// The first numTracks entries flag tracks, the rest observations
+	m_matched.assign(numTracks + numObserved, false);
+	for(unsigned k = 0; k < m_candidates.size(); ++k) {
+		const unsigned i = m_candidates[k].second.first;
+		const unsigned j = m_candidates[k].second.second;
+		if(m_matched[i] || m_matched[numTracks + j]) continue;
+		m_objects[i].correct((*observed)[j], m_alpha, m_beta);
+		m_matched[i] = true;
+		m_matched[numTracks + j] = true;
+	}
+	
+	for(unsigned i = 0; i < numTracks; ++i) {
+		if(!m_matched[i]) ++m_objects[i].m_missed;
+	}
+	
+	m_objects.erase(std::remove_if(m_objects.begin(), m_objects.end(),
+		MissedTooLong(m_maxMissed)), m_objects.end());
+	
+	for(unsigned j = 0; j < numObserved; ++j) {
+		if(m_matched[numTracks + j]) continue;
+		m_objects.push_back(TrackedObject(m_nextId++, (*observed)[j]));
+	}
+	
+	seed();
+}
+
+void ObjectTracker::reset()
+{
+	m_objects.clear();
+	m_sinceRefresh = 0;
+}
+
+const TrackedObjectVector &ObjectTracker::objects() const
+{
+	return m_objects;
+}
+
+const TrackedObject *ObjectTracker::object(const unsigned id) const
+{
+	TrackedObjectVector::const_iterator it = m_objects.begin();
+	for(; it != m_objects.end(); ++it) {
+		if(it->id() == id) return &*it;
+	}
+	return 0;
+}
+
+void ObjectTracker::setMaxDistance(const unsigned distance)
+{
+	m_maxDistance = distance;
+}
+
+unsigned ObjectTracker::maxDistance() const
+{
+	return m_maxDistance;
+}
+
+void ObjectTracker::setMaxMissed(const unsigned frames)
+{
+	m_maxMissed = frames;
+}
+
+unsigned ObjectTracker::maxMissed() const
+{
+	return m_maxMissed;
+}
+
+void ObjectTracker::setSmoothing(const double alpha, const double beta)
+{
+	m_alpha = alpha;
+	m_beta = beta;
+}
+
+void ObjectTracker::setSeedSearchWindow(const bool seed, const unsigned refreshInterval)
+{
+	m_seed = seed;
+	m_refreshInterval = refreshInterval;
+	m_sinceRefresh = 0;
+}
+
+bool ObjectTracker::seedSearchWindow() const
+{
+	return m_seed;
+}
+
+Channel *ObjectTracker::channel() const
+{
+	return m_channel;
+}
+
+void ObjectTracker::seed()
+{
+	if(!m_seed || !m_channel || m_objects.empty()) return;
+	if(++m_sinceRefresh >= m_refreshInterval) {
+		m_sinceRefresh = 0;
+		return;
+	}
+	
+	cv::Rect window;
+	TrackedObjectVector::const_iterator it = m_objects.begin();
+	for(; it != m_objects.end(); ++it) {
+		if(!it->isConfident()) return;
+		
+		// The predicted bounding box, grown by its own size on every side
+		const Rect<unsigned> &b = it->boundingBox();
+		const int w = b.width();
+		const int h = b.height();
+		const int x = (int)b.x() + (int)floor(it->velocityX() + 0.5) - w;
+		const int y = (int)b.y() + (int)floor(it->velocityY() + 0.5) - h;
+		const cv::Rect predicted(x, y, w * 3, h * 3);
+		
+		window = window.area() > 0 ? (window | predicted) : predicted;
+	}
+	
+	m_channel->setSearchWindow(window);
+}
@@ -0,0 +1,230 @@
+#include <kovan/occupancy_grid.hpp>
+#include <kovan/depth_image.hpp>
+#include <kovan/ground_plane.hpp>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using namespace depth;
+
+OccupancyGrid::OccupancyGrid()
+  : _columns(64)
+  , _rows(64)
+  , _cellSize(50)
+  , _minimumHeight(50)
+  , _maximumHeight(1000)
+  , _groundPlane(0)
+  , _cameraHeight(0)
+  , _sampleStep(2)
+  , _minPoints(2)
+  , _hitIncrement(96)
+  , _missDecrement(48)
+  , _occupiedThreshold(128)
+  , _cells(_columns * _rows, 0)
+{
+}
+
+void OccupancyGrid::setSize(const uint32_t columns, const uint32_t rows)
+{
+  _columns = columns;
+  _rows = rows;
+  _cells.assign(_columns * _rows, 0);
+  _occupied.clear();
+}
+
+uint32_t OccupancyGrid::columns() const
+{
+  return _columns;
+}
+
+uint32_t OccupancyGrid::rows() const
+{
+  return _rows;
+}
+
+void OccupancyGrid::setCellSize(const uint16_t cellSize)
+{
+  _cellSize = cellSize ? cellSize : 1;
+  clear();
+}
+
+uint16_t OccupancyGrid::cellSize() const
+{
+  return _cellSize;
+}
+
+void OccupancyGrid::setHeightBand(const int16_t minimum, const int16_t maximum)
+{
+  _minimumHeight = minimum;
+  _maximumHeight = maximum;
+}
+
+int16_t OccupancyGrid::minimumHeight() const
+{
+  return _minimumHeight;
+}
+
+int16_t OccupancyGrid::maximumHeight() const
+{
+  return _maximumHeight;
+}
+
+void OccupancyGrid::setGroundPlane(const GroundPlane *const groundPlane)
+{
+  _groundPlane = groundPlane;
+}
+
+const GroundPlane *OccupancyGrid::groundPlane() const
+{
+  return _groundPlane;
+}
+
+void OccupancyGrid::setCameraHeight(const uint16_t height)
+{
+  _cameraHeight = height;
+}
+
+uint16_t OccupancyGrid::cameraHeight() const
+{
+  return _cameraHeight;
+}
+
+void OccupancyGrid::setSampleStep(const uint32_t step)
+{
+  _sampleStep = step ? step : 1;
+}
+
+uint32_t OccupancyGrid::sampleStep() const
+{
+  return _sampleStep;
+}
+
+void OccupancyGrid::setMinPoints(const uint16_t points)
+{
+  _minPoints = points;
+}
+
+uint16_t OccupancyGrid::minPoints() const
+{
+  return _minPoints;
+}
+
+void OccupancyGrid::setUpdateRates(const uint8_t hitIncrement, const uint8_t missDecrement,
+  const uint8_t occupiedThreshold)
+{
+  _hitIncrement = hitIncrement;
+  _missDecrement = missDecrement;
+  _occupiedThreshold = occupiedThreshold;
+}
+
+void OccupancyGrid::update(const DepthImage &image)
+{
+  const uint32_t cells = _columns * _rows;
+  _hits.assign(cells, 0);
+  
+  const uint32_t w = image.width();
+  const uint32_t h = image.height();
+  _x.resize(w);
+  _y.resize(w);
+  _z.resize(w);
+  
+  const bool ground = _groundPlane && _groundPlane->isValid();
+  const int32_t left = -(int32_t)(_columns * _cellSize / 2);
+  for(uint32_t r = 0; w && r < h; r += _sampleStep) {
+    image.points(&_x[0], &_y[0], &_z[0], r, 1);
+    for(uint32_t c = 0; c < w; c += _sampleStep) {
+      const int32_t z = _z[c];
+      if(!z) continue;
+      
+      const float height = ground ? _groundPlane->height(Point3<int32_t>(_x[c], _y[c], z)) : _cameraHeight - _y[c];
+      if(height < _minimumHeight || height >= _maximumHeight) continue;
+      
+      const int32_t x = _x[c] - left;
+      if(x < 0) continue;
+      const uint32_t column = x / _cellSize;
+      const uint32_t row = z / _cellSize;
+      if(column >= _columns || row >= _rows) continue;
+      
+      uint16_t &hits = _hits[row * _columns + column];
+      if(hits < 0xFFFF) ++hits;
+    }
+  }
+  
+  _occupied.clear();
+  for(uint32_t i = 0; i < cells; ++i) {
+    const uint32_t value = _cells[i];
+    if(_hits[i] >= _minPoints) _cells[i] = value + _hitIncrement > 0xFF ? 0xFF : value + _hitIncrement;
+    else _cells[i] = value > _missDecrement ? value - _missDecrement : 0;
+    if(_cells[i] >= _occupiedThreshold) _occupied.push_back(i);
+  }
+}
+
+void OccupancyGrid::clear()
+{
+  _cells.assign(_columns * _rows, 0);
+  _occupied.clear();
+}
+
+uint8_t OccupancyGrid::value(const uint32_t column, const uint32_t row) const
+{
+  if(column >= _columns || row >= _rows) return 0;
+  return _cells[row * _columns + column];
+}
+
+bool OccupancyGrid::isOccupied(const uint32_t column, const uint32_t row) const
+{
+  return value(column, row) >= _occupiedThreshold;
+}
+
+const uint8_t *OccupancyGrid::data() const
+{
+  return _cells.empty() ? 0 : &_cells[0];
+}
+
+Point2<int32_t> OccupancyGrid::cellCenter(const uint32_t column, const uint32_t row) const
+{
+  return Point2<int32_t>(((int32_t)column * 2 + 1 - (int32_t)_columns) * _cellSize / 2,
+    (row * 2 + 1) * _cellSize / 2);
+}
+
+int32_t OccupancyGrid::nearestObstacle(const float fromAngle, const float toAngle,
+  Point2<int32_t> *const center) const
+{
+  const float from = fromAngle < toAngle ? fromAngle : toAngle;
+  const float to = fromAngle < toAngle ? toAngle : fromAngle;
+  
+  int32_t ret = -1;
+  std::vector<uint32_t>::const_iterator it = _occupied.begin();
+  for(; it != _occupied.end(); ++it) {
+    const Point2<int32_t> cell = cellCenter(*it % _columns, *it / _columns);
+    const float angle = atan2((float)cell.x(), (float)cell.y()) * 180.0f / M_PI;
+    if(angle < from || angle > to) continue;
+    
+    const int32_t distance = sqrt((float)cell.x() * cell.x() + (float)cell.y() * cell.y());
+    if(ret >= 0 && distance >= ret) continue;
+    ret = distance;
+    if(center) *center = cell;
+  }
+  return ret;
+}
+
+bool OccupancyGrid::isPathFree(const float angle, const uint32_t length, const uint32_t width) const
+{
+  const float radians = angle * M_PI / 180.0f;
+  const float s = sin(radians);
+  const float c = cos(radians);
+  
+  // Grow the corridor by half a cell, so any overlapping cell counts
+  const float margin = _cellSize * 0.5f;
+  const float halfWidth = width * 0.5f + margin;
+  
+  std::vector<uint32_t>::const_iterator it = _occupied.begin();
+  for(; it != _occupied.end(); ++it) {
+    const Point2<int32_t> cell = cellCenter(*it % _columns, *it / _columns);
+    const float along = cell.x() * s + cell.y() * c;
+    const float across = cell.x() * c - cell.y() * s;
+    if(along < -margin || along > length + margin) continue;
+    if(fabs(across) <= halfWidth) return false;
+  }
+  return true;
+}
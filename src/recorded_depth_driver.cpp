@@ -0,0 +1,303 @@
+#include "kovan/recorded_depth_driver.hpp"
+#include "kovan/depth_exception.hpp"
+#include "kovan/depth_filter.hpp"
+#include "kovan/util.h"
+
+#include <zlib.h>
+#include <cmath>
+#include <cstring>
+
+#define RECORDING_MAGIC "KDPT"
+#define RECORDING_MAGIC_SIZE 4
+
+#define RECORDING_FLAG_ZLIB 0x1
+
+// Used when the recorded images don't know their rays
+#define XTION_HORIZONTAL_FOV 1.0123f
+#define XTION_VERTICAL_FOV 0.7854f
+
+using namespace depth;
+
+// Recordings are a RECORDING_MAGIC, the frame width, height and flags as
+// 32 bit native endian integers, the x/z factor of every column and the
+// y/z factor of every row as floats. Every frame follows as its 32 bit
+// frame number, a double timestamp, the 32 bit payload size and the
+// payload: width * height native endian 16 bit depths in sensor order,
+// zlib compressed if the flag is set.
+
+template<typename T>
+static void put(std::ofstream &file, const T &value)
+{
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool get(std::ifstream &file, T &value)
+{
+  return file.read(reinterpret_cast<char *>(&value), sizeof(T)).good();
+}
+
+DepthRecorder::DepthRecorder()
+  : _compress(false)
+  , _width(0)
+  , _height(0)
+  , _frames(0)
+{
+}
+
+DepthRecorder::~DepthRecorder()
+{
+  close();
+}
+
+bool DepthRecorder::open(const std::string &path, const bool compress)
+{
+  if(_file.is_open()) return false;
+  _file.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!_file.is_open()) return false;
+  _compress = compress;
+  _width = 0;
+  _height = 0;
+  _frames = 0;
+  return true;
+}
+
+bool DepthRecorder::isOpen() const
+{
+  return _file.is_open();
+}
+
+bool DepthRecorder::write(const DepthImage &image)
+{
+  if(!_file.is_open()) return false;
+  const uint32_t width = image.width();
+  const uint32_t height = image.height();
+  if(!width || !height) return false;
+  
+  if(!_frames) {
+    _width = width;
+    _height = height;
+    _file.write(RECORDING_MAGIC, RECORDING_MAGIC_SIZE);
+    put(_file, _width);
+    put(_file, _height);
+    put<uint32_t>(_file, _compress ? RECORDING_FLAG_ZLIB : 0);
+    
+    const float *const columns = image.columnRays();
+    const float xzFactor = tan(XTION_HORIZONTAL_FOV / 2) * 2;
+    for(uint32_t column = 0; column < _width; ++column) {
+      put<float>(_file, columns ? columns[column] : ((float)column / _width - .5f) * xzFactor);
+    }
+    const float *const rows = image.rowRays();
+    const float yzFactor = tan(XTION_VERTICAL_FOV / 2) * 2;
+    for(uint32_t row = 0; row < _height; ++row) {
+      put<float>(_file, rows ? rows[row] : (.5f - (float)row / _height) * yzFactor);
+    }
+  } else if(width != _width || height != _height) return false;
+  
+  const uint32_t size = _width * _height;
+  _data.resize(size);
+  image.depth(&_data[0], 0, size);
+  
+  const unsigned char *payload = reinterpret_cast<const unsigned char *>(&_data[0]);
+  uLongf payloadSize = size * sizeof(uint16_t);
+  if(_compress) {
+    _compressed.resize(compressBound(payloadSize));
+    uLongf compressedSize = _compressed.size();
+    if(compress2(&_compressed[0], &compressedSize, payload, payloadSize, Z_BEST_SPEED) != Z_OK) {
+      return false;
+    }
+    payload = &_compressed[0];
+    payloadSize = compressedSize;
+  }
+  
+  put<uint32_t>(_file, image.frameNumber());
+  put<double>(_file, image.timestamp());
+  put<uint32_t>(_file, payloadSize);
+  _file.write(reinterpret_cast<const char *>(payload), payloadSize);
+  
+  if(!_file.good()) return false;
+  ++_frames;
+  return true;
+}
+
+bool DepthRecorder::close()
+{
+  if(!_file.is_open()) return false;
+  _file.close();
+  return true;
+}
+
+uint32_t DepthRecorder::frameCount() const
+{
+  return _frames;
+}
+
+RecordedDepthDriver::RecordedDepthDriver(const std::string &path)
+  : _path(path)
+  , _fps(0.0)
+  , _loop(false)
+  , _compressed(false)
+  , _filter(0)
+  , _current(-1)
+  , _next(0)
+  , _start(0.0)
+{
+}
+
+RecordedDepthDriver::~RecordedDepthDriver()
+{
+  close();
+}
+
+void RecordedDepthDriver::open()
+{
+  if(isOpen()) return;
+  
+  _file.open(_path.c_str(), std::ios::in | std::ios::binary);
+  if(!_file.is_open()) throw Exception("Unable to open " + _path);
+  
+  char magic[RECORDING_MAGIC_SIZE];
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t flags = 0;
+  _file.read(magic, RECORDING_MAGIC_SIZE);
+  if(!_file.good() || memcmp(magic, RECORDING_MAGIC, RECORDING_MAGIC_SIZE)
+    || !get(_file, width) || !get(_file, height) || !get(_file, flags) || !width || !height) {
+    _file.close();
+    throw Exception(_path + " is not a depth recording");
+  }
+  _compressed = flags & RECORDING_FLAG_ZLIB;
+  
+  _image.resize(width, height);
+  _file.read(reinterpret_cast<char *>(&_image._columns[0]), width * sizeof(float));
+  _file.read(reinterpret_cast<char *>(&_image._rows[0]), height * sizeof(float));
+  if(!_file.good()) {
+    _file.close();
+    throw Exception(_path + " has a truncated header");
+  }
+  
+  // Index the frames, so they can be picked without reading every payload
+  _offsets.clear();
+  for(;;) {
+    const std::streamoff offset = _file.tellg();
+    uint32_t frameNumber = 0;
+    double timestamp = 0.0;
+    uint32_t size = 0;
+    if(!get(_file, frameNumber) || !get(_file, timestamp) || !get(_file, size)) break;
+    if(!_file.seekg(size, std::ios::cur).good()) break;
+    _offsets.push_back(offset);
+  }
+  _file.clear();
+  
+  _current = -1;
+  _next = 0;
+  _start = seconds();
+}
+
+void RecordedDepthDriver::close()
+{
+  if(!isOpen()) return;
+  _file.close();
+  _offsets.clear();
+  _current = -1;
+}
+
+bool RecordedDepthDriver::isOpen() const
+{
+  return _file.is_open();
+}
+
+DepthResolution RecordedDepthDriver::depthCameraResolution() const
+{
+  if(!isOpen()) return DEPTH_INVALID_RESOLUTION;
+  if(_image._width == 320 && _image._height == 240) return DEPTH_RESOLUTION_320_240;
+  if(_image._width == 640 && _image._height == 480) return DEPTH_RESOLUTION_640_480;
+  return DEPTH_INVALID_RESOLUTION;
+}
+
+void RecordedDepthDriver::setDepthCameraResolution(const DepthResolution resolution)
+{
+  if(resolution != depthCameraResolution()) {
+    throw Exception("The resolution of a recording can't be changed");
+  }
+}
+
+DepthImage *RecordedDepthDriver::depthImage() const
+{
+  if(!isOpen() || _offsets.empty()) return 0;
+  
+  const uint32_t frames = _offsets.size();
+  uint32_t frame = _fps > 0.0 ? (uint32_t)((seconds() - _start) * _fps) : _next++;
+  if(frame >= frames) {
+    if(!_loop) return 0;
+    frame %= frames;
+  }
+  
+  if(frame != _current && !read(frame)) return 0;
+  return &_image;
+}
+
+void RecordedDepthDriver::setFilter(DepthFilter *const filter)
+{
+  _filter = filter;
+  if(_filter) _filter->reset();
+}
+
+DepthFilter *RecordedDepthDriver::filter() const
+{
+  return _filter;
+}
+
+void RecordedDepthDriver::setFrameRate(const double fps)
+{
+  _fps = fps;
+  _start = seconds();
+}
+
+double RecordedDepthDriver::frameRate() const
+{
+  return _fps;
+}
+
+void RecordedDepthDriver::setLoop(const bool loop)
+{
+  _loop = loop;
+}
+
+bool RecordedDepthDriver::loop() const
+{
+  return _loop;
+}
+
+uint32_t RecordedDepthDriver::frameCount() const
+{
+  return _offsets.size();
+}
+
+bool RecordedDepthDriver::read(const uint32_t frame) const
+{
+  _current = -1;
+  _file.clear();
+  _file.seekg(_offsets[frame], std::ios::beg);
+  
+  uint32_t size = 0;
+  if(!get(_file, _image._frameNumber) || !get(_file, _image._timestamp) || !get(_file, size)) {
+    return false;
+  }
+  
+  const uLongf expected = _image._depths.size() * sizeof(uint16_t);
+  unsigned char *const data = reinterpret_cast<unsigned char *>(&_image._depths[0]);
+  if(!_compressed) {
+    if(size != expected || !_file.read(reinterpret_cast<char *>(data), size).good()) return false;
+  } else {
+    _buffer.resize(size);
+    if(!size || !_file.read(reinterpret_cast<char *>(&_buffer[0]), size).good()) return false;
+    uLongf unpacked = expected;
+    if(uncompress(data, &unpacked, &_buffer[0], size) != Z_OK || unpacked != expected) return false;
+  }
+  
+  if(_filter) _filter->apply(&_image._depths[0], _image._width, _image._height);
+  
+  _current = frame;
+  return true;
+}
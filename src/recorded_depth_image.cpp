@@ -0,0 +1,25 @@
+#include "kovan/recorded_depth_image.hpp"
+
+using namespace depth;
+
+RecordedDepthImage::RecordedDepthImage()
+  : SensorDepthImage(0, 0, 0, 0, 0, 0.0, 0, 0)
+{
+}
+
+RecordedDepthImage::~RecordedDepthImage()
+{
+}
+
+void RecordedDepthImage::resize(const uint32_t width, const uint32_t height)
+{
+  _depths.assign(width * height, 0);
+  _columns.resize(width);
+  _rows.resize(height);
+  
+  _data = &_depths[0];
+  _width = width;
+  _height = height;
+  _columnRays = &_columns[0];
+  _rowRays = &_rows[0];
+}
@@ -0,0 +1,232 @@
+#include "kovan/recorded_input_provider.hpp"
+#include "time_p.hpp"
+#include "warn.hpp"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <cstring>
+
+#define RECORDING_MAGIC "KBGR"
+#define RECORDING_MAGIC_SIZE 4
+
+using namespace Camera;
+
+// Raw recordings are a RECORDING_MAGIC, the frame width and height as
+// 32 bit native endian integers, then width * height * 3 bytes of packed
+// BGR per frame.
+
+FrameRecorder::FrameRecorder()
+	: m_width(0),
+	m_height(0),
+	m_frames(0)
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	close();
+}
+
+bool FrameRecorder::open(const std::string &path)
+{
+	if(m_file.is_open()) return false;
+	m_file.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!m_file.is_open()) {
+		WARN("failed to open %s", path.c_str());
+		return false;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_frames = 0;
+	return true;
+}
+
+bool FrameRecorder::isOpen() const
+{
+	return m_file.is_open();
+}
+
+bool FrameRecorder::write(const cv::Mat &image)
+{
+	if(!m_file.is_open() || image.empty() || image.type() != CV_8UC3) return false;
+
+	if(!m_frames) {
+		m_width = image.cols;
+		m_height = image.rows;
+		const unsigned int header[2] = { m_width, m_height };
+		m_file.write(RECORDING_MAGIC, RECORDING_MAGIC_SIZE);
+		m_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+	} else if((unsigned)image.cols != m_width || (unsigned)image.rows != m_height) {
+		WARN("frame size changed during recording, dropping frame");
+		return false;
+	}
+
+	const size_t rowSize = m_width * 3;
+	if(image.isContinuous()) m_file.write(reinterpret_cast<const char *>(image.data), rowSize * m_height);
+	else {
+		for(unsigned row = 0; row < m_height; ++row) {
+			m_file.write(reinterpret_cast<const char *>(image.ptr(row)), rowSize);
+		}
+	}
+
+	if(!m_file.good()) return false;
+	++m_frames;
+	return true;
+}
+
+bool FrameRecorder::close()
+{
+	if(!m_file.is_open()) return false;
+	m_file.close();
+	return true;
+}
+
+unsigned FrameRecorder::frameCount() const
+{
+	return m_frames;
+}
+
+RecordedInputProvider::RecordedInputProvider(const std::string &path)
+	: m_path(path),
+	m_capture(0),
+	m_recordedWidth(0),
+	m_recordedHeight(0),
+	m_width(0),
+	m_height(0),
+	m_fps(0.0),
+	m_loop(false),
+	m_lastTick(0)
+{
+}
+
+RecordedInputProvider::~RecordedInputProvider()
+{
+	close();
+}
+
+bool RecordedInputProvider::open(const int number)
+{
+	if(isOpen()) return false;
+
+	m_file.open(m_path.c_str(), std::ios::in | std::ios::binary);
+	if(!m_file.is_open()) {
+		WARN("failed to open %s", m_path.c_str());
+		return false;
+	}
+
+	char magic[RECORDING_MAGIC_SIZE];
+	unsigned int header[2] = { 0, 0 };
+	m_file.read(magic, RECORDING_MAGIC_SIZE);
+	m_file.read(reinterpret_cast<char *>(header), sizeof(header));
+	if(m_file.good() && !memcmp(magic, RECORDING_MAGIC, RECORDING_MAGIC_SIZE)
+		&& header[0] && header[1]) {
+		m_recordedWidth = header[0];
+		m_recordedHeight = header[1];
+		m_lastTick = 0;
+		return true;
+	}
+	m_file.close();
+
+	// Not a raw recording. Let OpenCV try to decode it.
+	m_capture = new cv::VideoCapture(m_path);
+	if(!m_capture->isOpened()) {
+		WARN("%s is neither a raw recording nor a readable video", m_path.c_str());
+		delete m_capture;
+		m_capture = 0;
+		return false;
+	}
+	m_lastTick = 0;
+	return true;
+}
+
+bool RecordedInputProvider::isOpen() const
+{
+	return m_file.is_open() || m_capture;
+}
+
+void RecordedInputProvider::setWidth(const unsigned width)
+{
+	m_width = width;
+}
+
+void RecordedInputProvider::setHeight(const unsigned height)
+{
+	m_height = height;
+}
+
+bool RecordedInputProvider::next(cv::Mat &image)
+{
+	if(!isOpen()) return false;
+
+	if(!read(image)) {
+		if(!m_loop || !rewind() || !read(image)) return false;
+	}
+
+	if(m_width && m_height && ((unsigned)image.cols != m_width || (unsigned)image.rows != m_height)) {
+		cv::resize(image, image, cv::Size(m_width, m_height));
+	}
+
+	if(m_fps > 0.0) {
+		// Hold the frame back until its due time
+		const long long now = cv::getTickCount();
+		if(m_lastTick) {
+			const double remaining = 1.0 / m_fps - (now - m_lastTick) / cv::getTickFrequency();
+			if(remaining > 0.0) Private::Time::microsleep(remaining * 1000000.0);
+		}
+		m_lastTick = cv::getTickCount();
+	}
+
+	return true;
+}
+
+bool RecordedInputProvider::close()
+{
+	if(!isOpen()) return false;
+	if(m_file.is_open()) m_file.close();
+	delete m_capture;
+	m_capture = 0;
+	return true;
+}
+
+void RecordedInputProvider::setFrameRate(const double fps)
+{
+	m_fps = fps;
+}
+
+double RecordedInputProvider::frameRate() const
+{
+	return m_fps;
+}
+
+void RecordedInputProvider::setLoop(const bool loop)
+{
+	m_loop = loop;
+}
+
+bool RecordedInputProvider::loop() const
+{
+	return m_loop;
+}
+
+bool RecordedInputProvider::rewind()
+{
+	if(m_capture) {
+		close();
+		return open(0);
+	}
+
+	m_file.clear();
+	m_file.seekg(RECORDING_MAGIC_SIZE + 2 * sizeof(unsigned int), std::ios::beg);
+	return m_file.good();
+}
+
+bool RecordedInputProvider::read(cv::Mat &image)
+{
+	if(m_capture) return m_capture->read(image) && !image.empty();
+
+	// Read straight into the caller's buffer
+	image.create(m_recordedHeight, m_recordedWidth, CV_8UC3);
+	if(!image.isContinuous()) image = cv::Mat(m_recordedHeight, m_recordedWidth, CV_8UC3);
+	m_file.read(reinterpret_cast<char *>(image.data), image.total() * image.elemSize());
+	return m_file.good();
+}
@@ -0,0 +1,185 @@
+#include <kovan/rgbd_frame.hpp>
+#include <kovan/sensor_depth_image.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace depth;
+
+RgbdFrame::RgbdFrame()
+  : width(0)
+  , height(0)
+  , colorTimestamp(0)
+  , depthTimestamp(0)
+  , frameNumber(0)
+  , orientation(0)
+{
+}
+
+bool RgbdFrame::pointAt(const uint32_t row, const uint32_t column, Point3<int32_t> &point) const
+{
+  if(row >= height || column >= width || depth.size() != width * height) return false;
+  if(columnRays.size() != width || rowRays.size() != height) return false;
+  
+  const int32_t d = depth[SensorDepthImage::index(width, height, orientation, row, column)];
+  if(!d) return false;
+  point = Point3<int32_t>(d * columnRays[column], d * rowRays[row], d);
+  return true;
+}
+
+bool RgbdFrame::pointAt(const Rect<unsigned> &window, Point3<int32_t> &point) const
+{
+  if(depth.size() != width * height) return false;
+  if(columnRays.size() != width || rowRays.size() != height) return false;
+  
+  const uint32_t left = std::min<uint32_t>(window.x(), width);
+  const uint32_t top = std::min<uint32_t>(window.y(), height);
+  const uint32_t right = std::min<uint32_t>(window.x() + window.width(), width);
+  const uint32_t bottom = std::min<uint32_t>(window.y() + window.height(), height);
+  
+  std::vector<uint16_t> depths;
+  depths.reserve((right - left) * (bottom - top));
+  for(uint32_t r = top; r < bottom; ++r) {
+    for(uint32_t c = left; c < right; ++c) {
+      const uint16_t d = depth[SensorDepthImage::index(width, height, orientation, r, c)];
+      if(d) depths.push_back(d);
+    }
+  }
+  if(depths.empty()) return false;
+  
+  std::vector<uint16_t>::iterator median = depths.begin() + depths.size() / 2;
+  std::nth_element(depths.begin(), median, depths.end());
+  
+  const int32_t d = *median;
+  const uint32_t column = (left + right) / 2;
+  const uint32_t row = (top + bottom) / 2;
+  point = Point3<int32_t>(d * columnRays[std::min(column, width - 1)],
+    d * rowRays[std::min(row, height - 1)], d);
+  return true;
+}
+
+RgbdPairer::Color::Color()
+  : width(0)
+  , height(0)
+  , timestamp(0)
+  , valid(false)
+{
+}
+
+RgbdPairer::RgbdPairer()
+  : _maxSkew(16000)
+  , _nextColor(0)
+  , _depthWidth(0)
+  , _depthHeight(0)
+  , _depthTimestamp(0)
+  , _depthValid(false)
+  , _frameNumber(0)
+{
+}
+
+void RgbdPairer::setMaxSkew(const uint64_t microseconds)
+{
+  _mutex.lock();
+  _maxSkew = microseconds;
+  _mutex.unlock();
+}
+
+uint64_t RgbdPairer::maxSkew() const
+{
+  _mutex.lock();
+  const uint64_t ret = _maxSkew;
+  _mutex.unlock();
+  return ret;
+}
+
+void RgbdPairer::pushColor(const uint8_t *const data, const uint32_t width, const uint32_t height,
+  const uint64_t timestamp, const bool rgb)
+{
+  const uint32_t size = width * height * 3;
+  if(!data || !size) return;
+  
+  _mutex.lock();
+  // Overwrite the oldest frame
+  Color &color = _colors[_nextColor];
+  _nextColor = (_nextColor + 1) % ColorHistory;
+  
+  color.data.resize(size);
+  if(!rgb) memcpy(&color.data[0], data, size);
+  else {
+    uint8_t *const out = &color.data[0];
+    for(uint32_t i = 0; i < size; i += 3) {
+      out[i] = data[i + 2];
+      out[i + 1] = data[i + 1];
+      out[i + 2] = data[i];
+    }
+  }
+  color.width = width;
+  color.height = height;
+  color.timestamp = timestamp;
+  color.valid = true;
+  _mutex.unlock();
+}
+
+void RgbdPairer::pushDepth(const uint16_t *const data, const uint32_t width, const uint32_t height,
+  const uint64_t timestamp)
+{
+  const uint32_t size = width * height;
+  if(!data || !size) return;
+  
+  _mutex.lock();
+  _depth.assign(data, data + size);
+  _depthWidth = width;
+  _depthHeight = height;
+  _depthTimestamp = timestamp;
+  _depthValid = true;
+  _mutex.unlock();
+}
+
+bool RgbdPairer::take(RgbdFrame &frame)
+{
+  _mutex.lock();
+  if(!_depthValid) {
+    _mutex.unlock();
+    return false;
+  }
+  
+  int best = -1;
+  uint64_t bestSkew = 0;
+  for(int i = 0; i < ColorHistory; ++i) {
+    const Color &color = _colors[i];
+    if(!color.valid || color.width != _depthWidth || color.height != _depthHeight) continue;
+    
+    const uint64_t skew = color.timestamp > _depthTimestamp
+      ? color.timestamp - _depthTimestamp : _depthTimestamp - color.timestamp;
+    if(skew > _maxSkew || (best >= 0 && skew >= bestSkew)) continue;
+    best = i;
+    bestSkew = skew;
+  }
+  
+  if(best < 0) {
+    // The matching color frame may still be on its way
+    _mutex.unlock();
+    return false;
+  }
+  
+  Color &color = _colors[best];
+  frame.width = _depthWidth;
+  frame.height = _depthHeight;
+  frame.color.swap(color.data);
+  frame.depth.swap(_depth);
+  frame.colorTimestamp = color.timestamp;
+  frame.depthTimestamp = _depthTimestamp;
+  frame.frameNumber = ++_frameNumber;
+  color.valid = false;
+  _depthValid = false;
+  _mutex.unlock();
+  return true;
+}
+
+void RgbdPairer::clear()
+{
+  _mutex.lock();
+  for(int i = 0; i < ColorHistory; ++i) _colors[i].valid = false;
+  _depthValid = false;
+  _mutex.unlock();
+}
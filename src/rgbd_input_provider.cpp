@@ -0,0 +1,94 @@
+#include "kovan/rgbd_input_provider.hpp"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+using namespace Camera;
+
+RgbdInputProvider::RgbdInputProvider(depth::RgbdSource *const source)
+	: m_source(source),
+	m_width(0),
+	m_height(0)
+{
+}
+
+RgbdInputProvider::~RgbdInputProvider()
+{
+	close();
+	delete m_source;
+}
+
+bool RgbdInputProvider::open(const int number)
+{
+	if(m_source->isOpen()) return false;
+	m_frame = depth::RgbdFrame();
+	return m_source->open();
+}
+
+bool RgbdInputProvider::isOpen() const
+{
+	return m_source->isOpen();
+}
+
+void RgbdInputProvider::setWidth(const unsigned width)
+{
+	m_width = width;
+}
+
+void RgbdInputProvider::setHeight(const unsigned height)
+{
+	m_height = height;
+}
+
+bool RgbdInputProvider::next(cv::Mat &image)
+{
+	if(!m_source->isOpen()) return false;
+	
+	// Without a new pair, the last one is handed out again like
+	// DepthInputProvider does
+	if(!m_source->next(m_frame) && !m_frame.width) return false;
+	
+	// The frame's buffers are swapped out by the next pair, so the image
+	// always gets its own copy. Flipping it from sensor order keeps blob
+	// windows in the frame's oriented coordinates (see RgbdFrame).
+	const cv::Mat color(m_frame.height, m_frame.width, CV_8UC3, &m_frame.color[0]);
+	cv::flip(color, image, m_frame.orientation == 0 ? 1 : 0);
+	if(m_width && m_height && (m_width != m_frame.width || m_height != m_frame.height)) {
+		cv::resize(image, image, cv::Size(m_width, m_height));
+	}
+	
+	return true;
+}
+
+bool RgbdInputProvider::close()
+{
+	// The source may already have lost its device (e.g. to depth_close()),
+	// but still needs to drop its state
+	return m_source->close();
+}
+
+bool RgbdInputProvider::worldPoint(const Rect<unsigned> &window, Point3<int32_t> &point) const
+{
+	if(!m_frame.width || !m_frame.height) return false;
+	
+	// Windows are in image coordinates, which may be scaled
+	const unsigned width = m_width && m_height ? m_width : m_frame.width;
+	const unsigned height = m_width && m_height ? m_height : m_frame.height;
+	const unsigned left = window.x() * m_frame.width / width;
+	const unsigned top = window.y() * m_frame.height / height;
+	const unsigned right = (window.x() + window.width()) * m_frame.width / width;
+	const unsigned bottom = (window.y() + window.height()) * m_frame.height / height;
+	
+	return m_frame.pointAt(Rect<unsigned>(left, top, std::max(right - left, 1U),
+		std::max(bottom - top, 1U)), point);
+}
+
+depth::RgbdSource *RgbdInputProvider::source() const
+{
+	return m_source;
+}
+
+const depth::RgbdFrame &RgbdInputProvider::frame() const
+{
+	return m_frame;
+}
@@ -0,0 +1,212 @@
+#include <kovan/rgbd_source.hpp>
+#include <kovan/xtion_depth_driver.hpp>
+#include <kovan/sensor_depth_image.hpp>
+#include <kovan/depth.h>
+
+#include <iostream>
+#include <cmath>
+
+// Nominal field of view of the Xtion's color camera
+#define COLOR_HORIZONTAL_FOV 1.0225f
+#define COLOR_VERTICAL_FOV 0.7976f
+
+using namespace depth;
+
+RgbdSource::~RgbdSource()
+{
+}
+
+XtionRgbdSource::XtionRgbdSource()
+  : _open(false)
+  , _openedDriver(false)
+  , _enabledColor(false)
+{
+}
+
+XtionRgbdSource::~XtionRgbdSource()
+{
+  close();
+}
+
+bool XtionRgbdSource::open()
+{
+  if(isOpen()) return false;
+  
+  // Forget a session whose driver was closed by someone else
+  close();
+  
+  XtionDepthDriver &driver = XtionDepthDriver::instance();
+  try {
+    // Color is added to a driver the depth API already opened, rather
+    // than reopening it
+    const bool opened = !driver.isOpen();
+    const bool enabled = !driver.colorEnabled();
+    driver.setColorEnabled(true);
+    if(opened) driver.open();
+    
+    _openedDriver = opened;
+    _enabledColor = enabled;
+    _open = true;
+    return true;
+  }
+  catch(std::exception &e) { std::cerr << e.what() << std::endl; }
+  catch(const char *msg) { std::cerr << msg << std::endl; }
+  catch(...) {}
+  
+  return false;
+}
+
+bool XtionRgbdSource::isOpen() const
+{
+  const XtionDepthDriver &driver = XtionDepthDriver::instance();
+  return _open && driver.isOpen() && driver.colorEnabled();
+}
+
+bool XtionRgbdSource::close()
+{
+  if(!_open) return false;
+  
+  XtionDepthDriver &driver = XtionDepthDriver::instance();
+  if(_enabledColor) driver.setColorEnabled(false);
+  if(_openedDriver) driver.close();
+  _open = false;
+  _openedDriver = false;
+  _enabledColor = false;
+  return true;
+}
+
+bool XtionRgbdSource::next(RgbdFrame &frame)
+{
+  if(!_open || !XtionDepthDriver::instance().rgbdFrame(frame)) return false;
+  frame.orientation = get_depth_orientation();
+  return true;
+}
+
+SyntheticRgbdSource::SyntheticRgbdSource(const uint32_t width, const uint32_t height)
+  : _width(width)
+  , _height(height)
+  , _open(false)
+  , _backgroundDepth(0)
+  , _framePeriod(33333)
+  , _depthDelay(0)
+  , _time(0)
+  , _orientation(0)
+{
+  _background[0] = _background[1] = _background[2] = 0;
+  
+  const float xzFactor = tan(COLOR_HORIZONTAL_FOV / 2) * 2;
+  const float yzFactor = tan(COLOR_VERTICAL_FOV / 2) * 2;
+  _columnRays.resize(_width);
+  for(uint32_t column = 0; column < _width; ++column) {
+    _columnRays[column] = ((float)column / _width - .5f) * xzFactor;
+  }
+  _rowRays.resize(_height);
+  for(uint32_t row = 0; row < _height; ++row) {
+    _rowRays[row] = (.5f - (float)row / _height) * yzFactor;
+  }
+}
+
+bool SyntheticRgbdSource::open()
+{
+  if(_open) return false;
+  _pairer.clear();
+  // Leave room for negative depth delays
+  _time = 1000000;
+  _open = true;
+  return true;
+}
+
+bool SyntheticRgbdSource::isOpen() const
+{
+  return _open;
+}
+
+bool SyntheticRgbdSource::close()
+{
+  if(!_open) return false;
+  _open = false;
+  return true;
+}
+
+bool SyntheticRgbdSource::next(RgbdFrame &frame)
+{
+  if(!_open) return false;
+  
+  render();
+  _pairer.pushColor(&_color[0], _width, _height, _time);
+  _pairer.pushDepth(&_depth[0], _width, _height, _time + _depthDelay);
+  _time += _framePeriod;
+  
+  if(!_pairer.take(frame)) return false;
+  frame.columnRays = _columnRays;
+  frame.rowRays = _rowRays;
+  frame.orientation = _orientation;
+  return true;
+}
+
+void SyntheticRgbdSource::setBackground(const uint8_t blue, const uint8_t green, const uint8_t red,
+  const uint16_t depth)
+{
+  _background[0] = blue;
+  _background[1] = green;
+  _background[2] = red;
+  _backgroundDepth = depth;
+}
+
+void SyntheticRgbdSource::addBox(const Rect<unsigned> &pixels, const uint8_t blue,
+  const uint8_t green, const uint8_t red, const uint16_t depth)
+{
+  Box box = { pixels, { blue, green, red }, depth };
+  _boxes.push_back(box);
+}
+
+void SyntheticRgbdSource::clearBoxes()
+{
+  _boxes.clear();
+}
+
+void SyntheticRgbdSource::setFramePeriod(const uint64_t microseconds)
+{
+  _framePeriod = microseconds;
+}
+
+void SyntheticRgbdSource::setDepthDelay(const int64_t microseconds)
+{
+  _depthDelay = microseconds;
+}
+
+void SyntheticRgbdSource::setOrientation(const uint16_t orientation)
+{
+  _orientation = orientation;
+}
+
+RgbdPairer *SyntheticRgbdSource::pairer()
+{
+  return &_pairer;
+}
+
+void SyntheticRgbdSource::render()
+{
+  const uint32_t size = _width * _height;
+  _color.resize(size * 3);
+  _depth.assign(size, _backgroundDepth);
+  for(uint32_t i = 0; i < size; ++i) {
+    _color[i * 3] = _background[0];
+    _color[i * 3 + 1] = _background[1];
+    _color[i * 3 + 2] = _background[2];
+  }
+  
+  std::vector<Box>::const_iterator it = _boxes.begin();
+  for(; it != _boxes.end(); ++it) {
+    const Rect<unsigned> &p = it->pixels;
+    for(uint32_t r = p.y(); r < p.y() + p.height() && r < _height; ++r) {
+      for(uint32_t c = p.x(); c < p.x() + p.width() && c < _width; ++c) {
+        const uint32_t i = SensorDepthImage::index(_width, _height, _orientation, r, c);
+        _color[i * 3] = it->bgr[0];
+        _color[i * 3 + 1] = it->bgr[1];
+        _color[i * 3 + 2] = it->bgr[2];
+        _depth[i] = it->depth;
+      }
+    }
+  }
+}
@@ -0,0 +1,152 @@
+#include "kovan/sensor_depth_image.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace depth;
+
+SensorDepthImage::SensorDepthImage(const uint16_t *const data, const uint32_t width,
+    const uint32_t height, const uint16_t orientation, const uint32_t frameNumber,
+    const double timestamp, const float *const columnRays, const float *const rowRays)
+  : _data(data)
+  , _width(width)
+  , _height(height)
+  , _orientation(orientation)
+  , _frameNumber(frameNumber)
+  , _timestamp(timestamp)
+  , _columnRays(columnRays)
+  , _rowRays(rowRays)
+{
+}
+
+SensorDepthImage::~SensorDepthImage()
+{
+}
+
+void SensorDepthImage::setOrientation(const uint16_t orientation)
+{
+  // TODO: Check for correct orientation
+  _orientation = orientation;
+}
+
+uint16_t SensorDepthImage::orientation() const
+{
+  return _orientation;
+}
+
+uint32_t SensorDepthImage::height() const
+{
+  return _height;
+}
+
+uint32_t SensorDepthImage::width() const
+{
+  return _width;
+}
+
+uint32_t SensorDepthImage::index(const uint32_t width, const uint32_t height,
+  const uint16_t orientation, const uint32_t row, const uint32_t column)
+{
+  if(orientation == 0) return (width - 1 - column) + row * width;
+  return column + (height - 1 - row) * width;
+}
+
+uint32_t SensorDepthImage::index(const uint32_t row, const uint32_t column) const
+{
+  return index(_width, _height, _orientation, row, column);
+}
+
+const uint16_t *SensorDepthImage::rowData(const uint32_t row) const
+{
+  // Orientation 0 mirrors the columns, so its rows are read backwards
+  if(_orientation == 0) return _data + row * _width + _width - 1;
+  return _data + (_height - 1 - row) * _width;
+}
+
+uint16_t SensorDepthImage::depthAt(const uint32_t row, const uint32_t column) const
+{
+  return _data[index(row, column)];
+}
+
+void SensorDepthImage::depth(uint16_t *const data, const uint32_t offset, const uint32_t size) const
+{
+  const uint32_t total = _width * _height;
+  if(offset >= total) return;
+  const uint32_t clip = std::min(total - offset, size);
+  memcpy(data, _data + offset, clip * sizeof(uint16_t));
+}
+
+uint32_t SensorDepthImage::frameNumber() const
+{
+  return _frameNumber;
+}
+
+double SensorDepthImage::timestamp() const
+{
+  return _timestamp;
+}
+
+Point3<int32_t> SensorDepthImage::pointAt(const uint32_t row, const uint32_t column) const
+{
+  const int depth = depthAt(row, column);
+  if(depth == 0) return Point3<int32_t>(0, 0, 0);
+  return Point3<int32_t>(depth * _columnRays[column] - CenterOffset,
+    depth * _rowRays[row], depth);
+}
+
+void SensorDepthImage::points(Point3<int32_t> *const points, const uint32_t row, const uint32_t rows) const
+{
+  if(!_columnRays || !_rowRays) {
+    DepthImage::points(points, row, rows);
+    return;
+  }
+  
+  const int32_t step = _orientation == 0 ? -1 : 1;
+  for(uint32_t r = 0; r < rows; ++r) {
+    const float rowRay = _rowRays[row + r];
+    const uint16_t *src = rowData(row + r);
+    Point3<int32_t> *const out = points + r * _width;
+    for(uint32_t c = 0; c < _width; ++c, src += step) {
+      const int32_t depth = *src;
+      if(!depth) out[c] = Point3<int32_t>(0, 0, 0);
+      else out[c] = Point3<int32_t>(depth * _columnRays[c] - CenterOffset, depth * rowRay, depth);
+    }
+  }
+}
+
+void SensorDepthImage::points(int32_t *const x, int32_t *const y, int32_t *const z,
+  const uint32_t row, const uint32_t rows) const
+{
+  if(!_columnRays || !_rowRays) {
+    DepthImage::points(x, y, z, row, rows);
+    return;
+  }
+  
+  const int32_t step = _orientation == 0 ? -1 : 1;
+  for(uint32_t r = 0; r < rows; ++r) {
+    const float rowRay = _rowRays[row + r];
+    const uint16_t *src = rowData(row + r);
+    const uint32_t offset = r * _width;
+    for(uint32_t c = 0; c < _width; ++c, src += step) {
+      const int32_t depth = *src;
+      x[offset + c] = depth ? (int32_t)(depth * _columnRays[c] - CenterOffset) : 0;
+      y[offset + c] = depth * rowRay;
+      z[offset + c] = depth;
+    }
+  }
+}
+
+const float *SensorDepthImage::columnRays() const
+{
+  return _columnRays;
+}
+
+const float *SensorDepthImage::rowRays() const
+{
+  return _rowRays;
+}
+
+const uint16_t *SensorDepthImage::rawData() const
+{
+  return _data;
+}
@@ -49,6 +49,53 @@ Mutex::Mutex(const Mutex &)
 {
 }
 
+Condition::Condition()
+{
+#ifdef WIN32
+	InitializeConditionVariable(&m_handle);
+#else
+	pthread_cond_init(&m_handle, NULL);
+#endif
+}
+
+Condition::~Condition()
+{
+#ifndef WIN32
+	pthread_cond_destroy(&m_handle);
+#endif
+}
+
+void Condition::wait(Mutex &mutex)
+{
+#ifdef WIN32
+	SleepConditionVariableCS(&m_handle, &mutex.m_handle, INFINITE);
+#else
+	pthread_cond_wait(&m_handle, &mutex.m_handle);
+#endif
+}
+
+void Condition::signal()
+{
+#ifdef WIN32
+	WakeConditionVariable(&m_handle);
+#else
+	pthread_cond_signal(&m_handle);
+#endif
+}
+
+void Condition::broadcast()
+{
+#ifdef WIN32
+	WakeAllConditionVariable(&m_handle);
+#else
+	pthread_cond_broadcast(&m_handle);
+#endif
+}
+
+Condition::Condition(const Condition &)
+{
+}
+
 static void *__runThread(void *data)
 {
 	Thread *t = reinterpret_cast<Thread *>(data);
@@ -77,22 +124,30 @@ Thread::~Thread()
 #endif
 }
 
-void Thread::start()
+bool Thread::start()
 {
 #ifdef WIN32
 	m_thread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)__runThread,
 		reinterpret_cast<LPVOID>(this), 0, NULL);
+	if(!m_thread) m_thread = INVALID_HANDLE_VALUE;
+	return m_thread != INVALID_HANDLE_VALUE;
 #else
-	pthread_create(&m_thread, NULL, &__runThread,
-		reinterpret_cast<void *>(this));
+	if(pthread_create(&m_thread, NULL, &__runThread,
+		reinterpret_cast<void *>(this)) == 0) return true;
+	
+	// Leave join() a no-op
+	m_thread = pthread_self();
+	return false;
 #endif
 }
 
 void Thread::join()
 {
 #ifdef WIN32
-	if(m_thread < 0) return;
+	if(m_thread == INVALID_HANDLE_VALUE) return;
 	WaitForSingleObject(m_thread, INFINITE);
+	CloseHandle(m_thread);
+	m_thread = INVALID_HANDLE_VALUE;
 #else
 	if(pthread_equal(m_thread, pthread_self())) return;
 	pthread_join(m_thread, NULL);
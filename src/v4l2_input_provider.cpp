@@ -0,0 +1,330 @@
+#ifdef __linux__
+
+#include "kovan/v4l2_input_provider.hpp"
+#include "warn.hpp"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+
+using namespace Camera;
+
+static int xioctl(const int fd, const unsigned long request, void *const arg)
+{
+	int ret;
+	do ret = ioctl(fd, request, arg);
+	while(ret < 0 && errno == EINTR);
+	return ret;
+}
+
+V4L2InputProvider::V4L2InputProvider(const PixelFormat pixelFormat)
+	: m_fd(-1),
+	m_streaming(false),
+	m_pixelFormat(pixelFormat),
+	m_bufferCount(2),
+	m_dropStale(true),
+	m_width(160),
+	m_height(120),
+	m_bytesPerLine(0)
+{
+}
+
+V4L2InputProvider::~V4L2InputProvider()
+{
+	close();
+}
+
+bool V4L2InputProvider::open(const int number)
+{
+	if(m_fd >= 0) return false;
+
+	char path[32];
+	sprintf(path, "/dev/video%d", number);
+	m_fd = ::open(path, O_RDWR | O_NONBLOCK);
+	if(m_fd < 0) {
+		PWARN("failed to open %s", path);
+		return false;
+	}
+
+	v4l2_capability cap;
+	memset(&cap, 0, sizeof(cap));
+	if(xioctl(m_fd, VIDIOC_QUERYCAP, &cap) < 0
+		|| !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)
+		|| !(cap.capabilities & V4L2_CAP_STREAMING)) {
+		WARN("%s is not a streaming capture device", path);
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	if(!startStreaming()) {
+		stopStreaming();
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool V4L2InputProvider::isOpen() const
+{
+	return m_fd >= 0;
+}
+
+void V4L2InputProvider::setWidth(const unsigned width)
+{
+	if(m_width == width) return;
+	m_width = width;
+	if(m_streaming) restart();
+}
+
+void V4L2InputProvider::setHeight(const unsigned height)
+{
+	if(m_height == height) return;
+	m_height = height;
+	if(m_streaming) restart();
+}
+
+bool V4L2InputProvider::next(cv::Mat &image)
+{
+	if(!m_streaming) return false;
+
+	// Wait for the driver to fill a buffer
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET(m_fd, &fds);
+	timeval timeout;
+	timeout.tv_sec = 1;
+	timeout.tv_usec = 0;
+	int ret;
+	do ret = select(m_fd + 1, &fds, 0, 0, &timeout);
+	while(ret < 0 && errno == EINTR);
+	if(ret <= 0) {
+		if(!ret) WARN("timed out waiting for a frame");
+		else PWARN("select failed");
+		return false;
+	}
+
+	unsigned index = 0;
+	unsigned bytesUsed = 0;
+	if(!dequeue(index, bytesUsed)) return false;
+
+	if(m_dropStale) {
+		// Hand every older buffer straight back to the driver
+		unsigned newer = 0;
+		unsigned newerBytesUsed = 0;
+		while(dequeue(newer, newerBytesUsed)) {
+			enqueue(index);
+			index = newer;
+			bytesUsed = newerBytesUsed;
+		}
+	}
+
+	const bool success = convert(index, bytesUsed, image);
+	return enqueue(index) && success;
+}
+
+bool V4L2InputProvider::close()
+{
+	if(m_fd < 0) return false;
+	stopStreaming();
+	::close(m_fd);
+	m_fd = -1;
+	return true;
+}
+
+void V4L2InputProvider::setPixelFormat(const PixelFormat pixelFormat)
+{
+	if(m_pixelFormat == pixelFormat) return;
+	m_pixelFormat = pixelFormat;
+	if(m_streaming) restart();
+}
+
+V4L2InputProvider::PixelFormat V4L2InputProvider::pixelFormat() const
+{
+	return m_pixelFormat;
+}
+
+void V4L2InputProvider::setBufferCount(const unsigned count)
+{
+	const unsigned bufferCount = count ? count : 1;
+	if(m_bufferCount == bufferCount) return;
+	m_bufferCount = bufferCount;
+	if(m_streaming) restart();
+}
+
+unsigned V4L2InputProvider::bufferCount() const
+{
+	return m_bufferCount;
+}
+
+void V4L2InputProvider::setDropStaleFrames(const bool drop)
+{
+	m_dropStale = drop;
+}
+
+bool V4L2InputProvider::dropStaleFrames() const
+{
+	return m_dropStale;
+}
+
+bool V4L2InputProvider::startStreaming()
+{
+	v4l2_format fmt;
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.width = m_width;
+	fmt.fmt.pix.height = m_height;
+	fmt.fmt.pix.pixelformat = m_pixelFormat == Mjpeg ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+	fmt.fmt.pix.field = V4L2_FIELD_ANY;
+	if(xioctl(m_fd, VIDIOC_S_FMT, &fmt) < 0) {
+		PWARN("failed to set the capture format");
+		return false;
+	}
+
+	// The driver is free to pick the closest format it supports
+	if(fmt.fmt.pix.pixelformat != (m_pixelFormat == Mjpeg ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV)) {
+		WARN("the device doesn't support the requested pixel format");
+		return false;
+	}
+	m_width = fmt.fmt.pix.width;
+	m_height = fmt.fmt.pix.height;
+	m_bytesPerLine = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline : m_width * 2;
+
+	v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = m_bufferCount;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	if(xioctl(m_fd, VIDIOC_REQBUFS, &req) < 0 || !req.count) {
+		PWARN("failed to request %u buffers", m_bufferCount);
+		return false;
+	}
+
+	for(unsigned i = 0; i < req.count; ++i) {
+		v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if(xioctl(m_fd, VIDIOC_QUERYBUF, &buf) < 0) {
+			PWARN("failed to query buffer %u", i);
+			return false;
+		}
+
+		Buffer buffer;
+		buffer.length = buf.length;
+		buffer.start = mmap(0, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, buf.m.offset);
+		if(buffer.start == MAP_FAILED) {
+			PWARN("failed to map buffer %u", i);
+			return false;
+		}
+		m_buffers.push_back(buffer);
+
+		if(!enqueue(i)) return false;
+	}
+
+	v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if(xioctl(m_fd, VIDIOC_STREAMON, &type) < 0) {
+		PWARN("failed to start streaming");
+		return false;
+	}
+
+	m_streaming = true;
+	return true;
+}
+
+void V4L2InputProvider::stopStreaming()
+{
+	if(m_streaming) {
+		v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		xioctl(m_fd, VIDIOC_STREAMOFF, &type);
+		m_streaming = false;
+	}
+
+	std::vector<Buffer>::const_iterator it = m_buffers.begin();
+	for(; it != m_buffers.end(); ++it) munmap(it->start, it->length);
+	m_buffers.clear();
+
+	// Release the driver's buffers so the format can be changed
+	v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = 0;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	xioctl(m_fd, VIDIOC_REQBUFS, &req);
+}
+
+bool V4L2InputProvider::restart()
+{
+	stopStreaming();
+	if(startStreaming()) return true;
+	stopStreaming();
+	return false;
+}
+
+bool V4L2InputProvider::dequeue(unsigned &index, unsigned &bytesUsed)
+{
+	v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	if(xioctl(m_fd, VIDIOC_DQBUF, &buf) < 0) {
+		if(errno != EAGAIN) PWARN("failed to dequeue a buffer");
+		return false;
+	}
+	index = buf.index;
+	bytesUsed = buf.bytesused;
+	return true;
+}
+
+bool V4L2InputProvider::enqueue(const unsigned index)
+{
+	v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	if(xioctl(m_fd, VIDIOC_QBUF, &buf) < 0) {
+		PWARN("failed to queue buffer %u", index);
+		return false;
+	}
+	return true;
+}
+
+bool V4L2InputProvider::convert(const unsigned index, const unsigned bytesUsed, cv::Mat &image)
+{
+	if(index >= m_buffers.size()) return false;
+	void *const data = m_buffers[index].start;
+
+	if(m_pixelFormat == Mjpeg) {
+		const cv::Mat jpeg(1, bytesUsed, CV_8UC1, data);
+#if CV_VERSION_EPOCH == 3
+		cv::imdecode(jpeg, cv::IMREAD_COLOR, &image);
+#else
+		cv::imdecode(jpeg, CV_LOAD_IMAGE_COLOR, &image);
+#endif
+		return !image.empty();
+	}
+
+	// Wrap the mapped buffer and convert it in one pass
+	const cv::Mat yuyv(m_height, m_width, CV_8UC2, data, m_bytesPerLine);
+#if CV_VERSION_EPOCH == 3
+	cv::cvtColor(yuyv, image, cv::COLOR_YUV2BGR_YUYV);
+#else
+	cv::cvtColor(yuyv, image, CV_YUV2BGR_YUYV);
+#endif
+	return true;
+}
+
+#endif
@@ -71,3 +71,38 @@ DepthImage *XtionDepthDriver::depthImage() const
 {
   return _impl->lastCaptured();
 }
+
+void XtionDepthDriver::setRecorder(DepthRecorder *const recorder)
+{
+  _impl->setRecorder(recorder);
+}
+
+DepthRecorder *XtionDepthDriver::recorder() const
+{
+  return _impl->recorder();
+}
+
+void XtionDepthDriver::setFilter(DepthFilter *const filter)
+{
+  _impl->setFilter(filter);
+}
+
+DepthFilter *XtionDepthDriver::filter() const
+{
+  return _impl->filter();
+}
+
+void XtionDepthDriver::setColorEnabled(const bool enabled)
+{
+  _impl->setColorEnabled(enabled);
+}
+
+bool XtionDepthDriver::colorEnabled() const
+{
+  return _impl->colorEnabled();
+}
+
+bool XtionDepthDriver::rgbdFrame(RgbdFrame &frame)
+{
+  return _impl->rgbdFrame(frame);
+}
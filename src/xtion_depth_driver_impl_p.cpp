@@ -1,11 +1,29 @@
 #include "xtion_depth_driver_impl_p.hpp"
+#include <kovan/recorded_depth_driver.hpp>
+#include <kovan/depth_filter.hpp>
 #include <kovan/depth_exception.hpp>
+#include <cstring>
+#include <cmath>
 
 using namespace depth;
 using namespace openni;
 
+XtionDepthDriverImpl::Frame::Frame()
+  : width(0)
+  , height(0)
+  , frameNumber(0)
+  , timestamp(0.0)
+{
+}
+
 XtionDepthDriverImpl::XtionDepthDriverImpl()
-  : _lastCaptured(0, 0, 0, 0, 0, 0)
+  : _colorEnabled(false)
+  , _published(-1)
+  , _reading(-1)
+  , _frameNumber(0)
+  , _lastCaptured(0, 0, 0, 0, 0, 0)
+  , _recorder(0)
+  , _filter(0)
 {
   Status rc = OpenNI::initialize();
   if(rc != STATUS_OK) {
@@ -76,6 +94,99 @@ void XtionDepthDriverImpl::open()
     throw Exception(std::string("Adding the frame listener failed with\n")
       + OpenNI::getExtendedError());
   }
+  
+  mode = _stream.getVideoMode();
+  _mutex.lock();
+  rays(mode.getResolutionX(), mode.getResolutionY());
+  _mutex.unlock();
+  
+  if(!_colorEnabled) return;
+  
+  try {
+    openColor();
+  } catch(...) {
+    close();
+    throw;
+  }
+}
+
+void XtionDepthDriverImpl::openColor()
+{
+  if(!_device.getSensorInfo(SENSOR_COLOR)) {
+    throw Exception("Device has no color sensor!");
+  }
+  
+  if(!_device.isImageRegistrationModeSupported(IMAGE_REGISTRATION_DEPTH_TO_COLOR)) {
+    throw Exception("Device doesn't support depth to color registration!");
+  }
+  
+  Status rc = _colorStream.create(_device, SENSOR_COLOR);
+  if(rc != STATUS_OK) {
+    throw Exception(std::string("Create the color stream failed with\n")
+      + OpenNI::getExtendedError());
+  }
+  
+  _pairer.clear();
+  if(!matchColorMode()) {
+    closeColor();
+    throw Exception(std::string("Starting the color stream failed with\n")
+      + OpenNI::getExtendedError());
+  }
+  
+  _device.setImageRegistrationMode(IMAGE_REGISTRATION_DEPTH_TO_COLOR);
+  _device.setDepthColorSyncEnabled(true);
+  
+  rc = _colorStream.addNewFrameListener(this);
+  if(rc != STATUS_OK) {
+    closeColor();
+    throw Exception(std::string("Adding the color frame listener failed with\n")
+      + OpenNI::getExtendedError());
+  }
+}
+
+void XtionDepthDriverImpl::closeColor()
+{
+  if(!_colorStream.isValid()) return;
+  
+  _colorStream.removeNewFrameListener(this);
+  _colorStream.stop();
+  _colorStream.destroy();
+  _pairer.clear();
+  
+  // Depth goes back to the depth camera's own view
+  _device.setDepthColorSyncEnabled(false);
+  _device.setImageRegistrationMode(IMAGE_REGISTRATION_OFF);
+}
+
+bool XtionDepthDriverImpl::matchColorMode()
+{
+  _colorStream.stop();
+  
+  // Registration needs both streams at the same resolution
+  const VideoMode depthMode = _stream.getVideoMode();
+  VideoMode mode = _colorStream.getVideoMode();
+  mode.setPixelFormat(PIXEL_FORMAT_RGB888);
+  mode.setResolution(depthMode.getResolutionX(), depthMode.getResolutionY());
+  mode.setFps(depthMode.getFps());
+  if(_colorStream.setVideoMode(mode) != STATUS_OK) return false;
+  if(_colorStream.start() != STATUS_OK) return false;
+  
+  const uint32_t width = mode.getResolutionX();
+  const uint32_t height = mode.getResolutionY();
+  const float xzFactor = tan(_colorStream.getHorizontalFieldOfView() / 2) * 2;
+  const float yzFactor = tan(_colorStream.getVerticalFieldOfView() / 2) * 2;
+  
+  _colorRays.columns.resize(width);
+  for(uint32_t column = 0; column < width; ++column) {
+    _colorRays.columns[column] = ((float)column / width - .5f) * xzFactor;
+  }
+  
+  _colorRays.rows.resize(height);
+  for(uint32_t row = 0; row < height; ++row) {
+    _colorRays.rows[row] = (.5f - (float)row / height) * yzFactor;
+  }
+  
+  return true;
 }
 
 bool XtionDepthDriverImpl::isOpen() const
@@ -87,6 +198,8 @@ void XtionDepthDriverImpl::close()
 {
   if(!isOpen()) return;
   
+  closeColor();
+  
   _stream.removeNewFrameListener(this);
 
   _stream.stop();
@@ -140,18 +253,132 @@ void XtionDepthDriverImpl::setDepthCameraResolution(const DepthResolution resolu
     
     throw Exception("Unable to start the depth stream");
   }
+  
+  _mutex.lock();
+  rays(mode.getResolutionX(), mode.getResolutionY());
+  _mutex.unlock();
+  
+  if(_colorStream.isValid() && !matchColorMode()) {
+    close();
+    
+    throw Exception("Unable to restart the color stream");
+  }
 }
 
 XtionDepthImage *XtionDepthDriverImpl::lastCaptured()
 {
+  _mutex.lock();
+  const bool fresh = _published >= 0;
+  if(fresh) {
+    // Take over the newest frame; the old one becomes writable again
+    _reading = _published;
+    _published = -1;
+    
+    const Frame &frame = _frames[_reading];
+    const Rays *const r = rays(frame.width, frame.height);
+    _lastCaptured = XtionDepthImage(&frame.data[0], frame.data.size() * sizeof(DepthPixel),
+      frame.width, frame.height, _lastCaptured.orientation(), this,
+      frame.frameNumber, frame.timestamp,
+      r ? &r->columns[0] : 0, r ? &r->rows[0] : 0);
+  }
+  _mutex.unlock();
+  
+  // The buffer being read is never written, so record outside the lock
+  if(fresh && _recorder) _recorder->write(_lastCaptured);
+  
   return _lastCaptured.data() ? &_lastCaptured : 0;
 }
 
+void XtionDepthDriverImpl::setRecorder(DepthRecorder *const recorder)
+{
+  _recorder = recorder;
+}
+
+DepthRecorder *XtionDepthDriverImpl::recorder() const
+{
+  return _recorder;
+}
+
+void XtionDepthDriverImpl::setFilter(DepthFilter *const filter)
+{
+  _filterMutex.lock();
+  _filter = filter;
+  if(_filter) _filter->reset();
+  _filterMutex.unlock();
+}
+
+DepthFilter *XtionDepthDriverImpl::filter() const
+{
+  _filterMutex.lock();
+  DepthFilter *const ret = _filter;
+  _filterMutex.unlock();
+  return ret;
+}
+
+void XtionDepthDriverImpl::setColorEnabled(const bool enabled)
+{
+  if(enabled == _colorEnabled) return;
+  _colorEnabled = enabled;
+  if(!isOpen()) return;
+  
+  // Depth keeps streaming either way
+  if(!enabled) {
+    closeColor();
+    return;
+  }
+  
+  try {
+    openColor();
+  } catch(...) {
+    _colorEnabled = false;
+    throw;
+  }
+}
+
+bool XtionDepthDriverImpl::colorEnabled() const
+{
+  return _colorEnabled;
+}
+
+bool XtionDepthDriverImpl::rgbdFrame(RgbdFrame &frame)
+{
+  if(!_colorStream.isValid() || !_pairer.take(frame)) return false;
+  frame.columnRays = _colorRays.columns;
+  frame.rowRays = _colorRays.rows;
+  return true;
+}
+
 const openni::VideoStream &XtionDepthDriverImpl::stream() const
 {
   return _stream;
 }
 
+const XtionDepthDriverImpl::Rays *XtionDepthDriverImpl::rays(const uint32_t width, const uint32_t height)
+{
+  if(!width || !height) return 0;
+  
+  const std::pair<uint32_t, uint32_t> key(width, height);
+  std::map<std::pair<uint32_t, uint32_t>, Rays>::const_iterator it = _rays.find(key);
+  if(it != _rays.end()) return &it->second;
+  if(!_stream.isValid()) return 0;
+  
+  const float xzFactor = tan(_stream.getHorizontalFieldOfView() / 2) * 2;
+  const float yzFactor = tan(_stream.getVerticalFieldOfView() / 2) * 2;
+  
+  Rays &ret = _rays[key];
+  ret.columns.resize(width);
+  for(uint32_t column = 0; column < width; ++column) {
+    ret.columns[column] = ((float)column / width - .5f) * xzFactor;
+  }
+  
+  ret.rows.resize(height);
+  for(uint32_t row = 0; row < height; ++row) {
+    ret.rows[row] = (.5f - (float)row / height) * yzFactor;
+  }
+  
+  return &ret;
+}
+
 void XtionDepthDriverImpl::onDeviceConnected(const DeviceInfo *pInfo)
 {
 }
@@ -167,7 +394,45 @@ void XtionDepthDriverImpl::onDeviceStateChanged(const DeviceInfo *pInfo, DeviceS
 void XtionDepthDriverImpl::onNewFrame(VideoStream &stream)
 {
   VideoFrameRef ref;
-  stream.readFrame(&ref);
-  _lastCaptured = XtionDepthImage(ref.getData(), ref.getDataSize(),
-    ref.getWidth(), ref.getHeight(), 0, this);
+  if(stream.readFrame(&ref) != STATUS_OK || !ref.getData()) return;
+  
+  if(&stream == &_colorStream) {
+    _pairer.pushColor(reinterpret_cast<const uint8_t *>(ref.getData()),
+      ref.getWidth(), ref.getHeight(), ref.getTimestamp(), true);
+    return;
+  }
+  
+  const uint32_t pixels = ref.getDataSize() / sizeof(DepthPixel);
+  if(!pixels) return;
+  
+  // Any buffer that is neither handed out nor published is free
+  _mutex.lock();
+  int free = 0;
+  while(free == _published || free == _reading) ++free;
+  _mutex.unlock();
+  
+  Frame &frame = _frames[free];
+  frame.data.resize(pixels);
+  memcpy(&frame.data[0], ref.getData(), pixels * sizeof(DepthPixel));
+  frame.width = ref.getWidth();
+  frame.height = ref.getHeight();
+  
+  _filterMutex.lock();
+  if(_filter && pixels == frame.width * frame.height) {
+    _filter->apply(&frame.data[0], frame.width, frame.height);
+  }
+  _filterMutex.unlock();
+
+  if(_colorStream.isValid()) {
+    _pairer.pushDepth(&frame.data[0], frame.width, frame.height, ref.getTimestamp());
+  }
+
+  frame.frameNumber = ++_frameNumber;
+  // The sensor's capture time, on the same clock the color stream is
+  // paired on
+  frame.timestamp = ref.getTimestamp() / 1000000.0;
+  
+  _mutex.lock();
+  _published = free;
+  _mutex.unlock();
 }
\ No newline at end of file
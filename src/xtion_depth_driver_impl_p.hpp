@@ -4,9 +4,16 @@
 #include <OpenNI.h>
 #include <kovan/depth_resolution.h>
 #include <kovan/xtion_depth_image.hpp>
+#include <kovan/rgbd_frame.hpp>
+#include <kovan/thread.hpp>
+#include <vector>
+#include <map>
 
 namespace depth
 {
+  class DepthRecorder;
+  class DepthFilter;
+  
   class XtionDepthDriverImpl : public openni::OpenNI::DeviceConnectedListener
                              , public openni::OpenNI::DeviceDisconnectedListener
                              , public openni::OpenNI::DeviceStateChangedListener
@@ -22,15 +29,90 @@ namespace depth
     DepthResolution depthCameraResolution() const;
     void setDepthCameraResolution(const DepthResolution resolution);
     
+    /**
+     * Returns the newest complete frame. The returned image is owned by the
+     * driver and stays valid and unchanged until a later call picks up a
+     * newer frame, no matter how many frames arrive in between.
+     */
     XtionDepthImage *lastCaptured();
     
+    void setRecorder(DepthRecorder *const recorder);
+    DepthRecorder *recorder() const;
+    
+    void setFilter(DepthFilter *const filter);
+    DepthFilter *filter() const;
+    
+    /**
+     * Starts or stops the color stream, right away if the device is open.
+     * While it runs, the depth stream is registered to the color stream
+     * in hardware and both are synchronized.
+     */
+    void setColorEnabled(const bool enabled);
+    bool colorEnabled() const;
+    
+    /**
+     * Takes the newest paired color and depth frames
+     */
+    bool rgbdFrame(RgbdFrame &frame);
+    
     const openni::VideoStream &stream() const;
     
   private:
+    // Frames are exchanged between the OpenNI thread and readers through
+    // three owned buffers: the one handed out to readers, the newest
+    // published one and one being written.
+    enum { FrameCount = 3 };
+    
+    struct Frame
+    {
+      Frame();
+      
+      std::vector<openni::DepthPixel> data;
+      uint32_t width;
+      uint32_t height;
+      uint32_t frameNumber;
+      double timestamp;
+    };
+    
+    // The x/z factor of every column and the y/z factor of every row, as
+    // CoordinateConverter would use them
+    struct Rays
+    {
+      std::vector<float> columns;
+      std::vector<float> rows;
+    };
+    
+    // Tables are kept once built, so images may keep pointing into them.
+    // The map is shared with lastCaptured(), so hold _mutex while calling.
+    const Rays *rays(const uint32_t width, const uint32_t height);
+    
+    void openColor();
+    void closeColor();
+    
+    // Sets the color stream to the depth stream's resolution
+    bool matchColorMode();
+    
     openni::Device _device;
     openni::VideoStream _stream;
+    openni::VideoStream _colorStream;
+    bool _colorEnabled;
+    RgbdPairer _pairer;
+    Rays _colorRays;
+    
+    std::map<std::pair<uint32_t, uint32_t>, Rays> _rays;
+    
+    Frame _frames[FrameCount];
+    int _published;
+    int _reading;
+    uint32_t _frameNumber;
+    Mutex _mutex;
     
     XtionDepthImage _lastCaptured;
+    DepthRecorder *_recorder;
+    
+    // Held while the filter runs, so it can't be swapped out midway
+    DepthFilter *_filter;
+    mutable Mutex _filterMutex;
     
     // Implement OpenNI::DeviceConnectedListener::onDeviceConnected()
     virtual void onDeviceConnected(const openni::DeviceInfo *pInfo);
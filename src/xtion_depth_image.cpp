@@ -27,12 +27,12 @@ using namespace depth;
 using namespace openni;
 
 XtionDepthImage::XtionDepthImage(const void *const data, const uint32_t size, const uint32_t width,
-    const uint32_t height, const uint16_t orientation, XtionDepthDriverImpl *const impl)
-  : _data(data)
+    const uint32_t height, const uint16_t orientation, XtionDepthDriverImpl *const impl,
+    const uint32_t frameNumber, const double timestamp,
+    const float *const columnRays, const float *const rowRays)
+  : SensorDepthImage(reinterpret_cast<const uint16_t *>(data), width, height, orientation,
+      frameNumber, timestamp, columnRays, rowRays)
   , _size(size)
-  , _width(width)
-  , _height(height)
-  , _orientation(orientation)
   , _impl(impl)
 {
 }
@@ -41,63 +41,24 @@ XtionDepthImage::~XtionDepthImage()
 {
 }
 
-void XtionDepthImage::setOrientation(const uint16_t orientation)
-{
-  // TODO: Check for correct orientation
-  _orientation = orientation;
-}
-
-uint16_t XtionDepthImage::orientation() const
-{
-  return _orientation;
-}
-
-uint16_t XtionDepthImage::depthAt(const uint32_t row, const uint32_t column) const
-{
-  if(_orientation == 0) {
-    return reinterpret_cast<const DepthPixel *>(_data)[(_width - column) + row * _width];
-  }
-  
-  return reinterpret_cast<const DepthPixel *>(_data)[column + (_height - row) * _width];
-}
-
-void XtionDepthImage::depth(uint16_t *const data, const uint32_t offset, const uint32_t size) const
-{
-  const uint32_t clip = std::max(_width * _height - offset, size);
-  memcpy(data, reinterpret_cast<const DepthPixel *>(_data) + offset, size * sizeof(DepthPixel));
-}
-
-uint32_t XtionDepthImage::width() const
-{
-  return _width;
-}
-
-uint32_t XtionDepthImage::height() const
-{
-  return _height;
-}
-
 Point3<int32_t> XtionDepthImage::pointAt(const uint32_t row, const uint32_t column) const
 {
+  if(_columnRays && _rowRays) return SensorDepthImage::pointAt(row, column);
+  
   const int depth = depthAt(row, column);
+  if(depth == 0) return Point3<int32_t>(0, 0, 0);
+  
   float worldX = 0.0f;
   float worldY = 0.0f;
   float worldZ = 0.0f;
-      
-  if(depth == 0) return Point3<int32_t>(0, 0, 0);
-  
   Status rc = CoordinateConverter::convertDepthToWorld(_impl->stream(), 
     (int)column, (int)row, depth, &worldX, &worldY, &worldZ);
-  if(rc != STATUS_OK) {
-    throw Exception(std::string("Coordinate conversion failed with ")
-      + OpenNI::getExtendedError());
-  }
+  if(rc != STATUS_OK) return Point3<int32_t>(0, 0, 0);
   
-  // Center of Xtion offset is 44 mm
-  return Point3<int32_t>(worldX - 44, worldY, worldZ);
+  return Point3<int32_t>(worldX - CenterOffset, worldY, worldZ);
 }
 
 const void *XtionDepthImage::data() const
 {
   return _data;
-}
\ No newline at end of file
+}